@@ -4,15 +4,14 @@ INCLUDEPATH = ../..
 TARGET = $$qtLibraryTarget(flx)
 DESTDIR = ../../../lib/tiled/plugins
 DEFINES += FLX_LIBRARY
+include(flxcore.pri)
 SOURCES += flxexporter.cpp \
     settingsdialog.cpp \
-    as3level.cpp \
-    progressdialog.cpp
+    progressdialog.cpp \
+    tiledmapconverter.cpp
 HEADERS += flxexporter.h \
     settingsdialog.h \
-    as3level.h \
-    as3levelplaceholders.h \
-    progressdialog.h
-RESOURCES += ASTemplates.qrc
+    progressdialog.h \
+    tiledmapconverter.h
 FORMS += settingsdialog.ui \
     progressdialog.ui
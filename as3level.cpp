@@ -19,136 +19,245 @@
  * Place, Suite 330, Boston, MA 02111-1307, USA.
  */
 
+#include <cstring>
+
 #include <QFile>
 #include <QByteArray>
 #include <QPixmap>
-#include <QPainter>
 #include <QDir>
 #include <QTextStream>
 #include <QFileInfo>
 #include <QDebug>
 #include <QList>
-#include <QApplication>
-
-#include "tilelayer.h"
-#include "layer.h"
-#include "tile.h"
-
-#include "progressdialog.h"
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QHash>
+#include <QtAlgorithms>
+#include <QStringList>
+#include <QThread>
+#include <QtConcurrentMap>
+
+#include "atomicfile.h"
+#include "backgroundbaker.h"
+#include "tilecache.h"
+#include "tileoutline.h"
+#include "pngwriter.h"
+#include "navgrid.h"
+#include "minimaprenderer.h"
+#include "exportsnapshots.h"
 #include "as3levelplaceholders.h"
+#include "layerproperties.h"
 #include "as3level.h"
 
 using namespace Flx;
 
-AS3Level::AS3Level()
+namespace
 {
-    loadBlueprint();
-}
-
-/**
- * Function maps every tileset to its first GID
- * * Potentially not required (and not used)
- * @todo Get rid of this function
- */
-void AS3Level::initTilesetGIDmap(const Tiled::Map *map)
-{
-    int firstGid = 1;
-    foreach (const Tiled::Tileset *tileset, map->tilesets())
+    /**
+     * Orders GIDs by descending use count
+     */
+    struct MoreFrequent
     {
-        this->tilesetFirstGidMap[tileset] = firstGid;
-        firstGid += tileset->tileCount();
-    }
-}
+        MoreFrequent(const QHash<int, int> &counts) : counts(counts) {}
 
-void AS3Level::saveLayerTilesheet(const QString &fileName,
-                                  const Tiled::Map* map,
-                                  const QMap<Tiled::Tile *, int> &idMap
-                                  ) const
-{
-    // index 0 = NULL
-    //unsigned int tileCount = 1 + idMap.count() * partsPerTile;
+        bool operator()(int a, int b) const
+        {
+            return counts.value(a) > counts.value(b);
+        }
+
+        const QHash<int, int> &counts;
+    };
 
-    unsigned int imageWidth = map->tileWidth();     // initial empty tile for flixel
-    foreach (Tiled::Tile *tile, idMap.keys())
+    /**
+     * Rows [top, bottom) of a grid, processed by one worker
+     */
+    struct RowBand
     {
-        if (tile == NULL) continue;
+        const TileGrid *grid;
+        int top;
+        int bottom;
+    };
 
-        int partCount = (tile->width() * tile->height()) / (map->tileWidth() * map->tileHeight());
-        imageWidth += partCount * map->tileWidth();
-    }
+    typedef QHash<int, int> GidCounts;      // cells using each GID
 
-    QPixmap pm(imageWidth,
-               map->tileHeight());
-    pm.fill(Qt::transparent);
-    QPainter painter(&pm);
+    // bands smaller than this cost more to schedule than to process
+    const int MIN_BAND_CELLS = 64 * 1024;
 
-    foreach (Tiled::Tile *tile, idMap.keys())
+    /**
+     * Function splits a grid into bands of whole rows, a few per core so
+     * that uneven bands still balance out
+     */
+    void appendRowBands(const TileGrid &grid, QList<RowBand> &bands)
     {
-        if (tile == NULL)
+        int bandCount = qMax(1, QThread::idealThreadCount()) * 4;
+        int rowsPerBand = qMax((grid.height() + bandCount - 1) / bandCount,
+                               MIN_BAND_CELLS / qMax(1, grid.width()));
+        rowsPerBand = qMax(1, rowsPerBand);
+
+        for (int top = 0; top < grid.height(); top += rowsPerBand)
         {
-            qDebug() << "Encountered NULL tile while saving tilesheet\n";
-            continue;
+            RowBand band;
+            band.grid = &grid;
+            band.top = top;
+            band.bottom = qMin(top + rowsPerBand, grid.height());
+            bands.append(band);
         }
+    }
 
-        unsigned int xRatio = tile->width() / map->tileWidth();
-        unsigned int yRatio = tile->height() / map->tileWidth();
-
-        int tileOffset = map->tileWidth();
-        int checkedIndex = 1;
-        qDebug() << "Current tile: " << idMap[tile] << "\n";
-        while (checkedIndex < idMap[tile])
+    /**
+     * Function counts the cells using each GID; runs of the same tile are
+     * common, so whole runs are counted at once
+     */
+    GidCounts countBandGids(const RowBand &band)
+    {
+        GidCounts counts;
+        const int width = band.grid->width();
+        for (int j = band.top; j < band.bottom; ++j)
         {
-            /**
-             * @todo Optimize offset finding (not that easy, since we can't calculate
-             * it directly (due to possibly varying tile sizes in one layer)
-             */
-            foreach (Tiled::Tile *t, idMap.keys())
+            const int *row = band.grid->constRow(j);
+            for (int i = 0; i < width; )
             {
-                if (t == NULL) continue;
+                int run = i + 1;
+                while (run < width && row[run] == row[i]) ++run;
 
-                int testIndex = idMap[t];
-                if (checkedIndex == testIndex)
-                {
-                    int tileParts = (t->width() * t->height()) / (map->tileHeight() * map->tileWidth());
+                if (row[i] != 0) counts[row[i]] += run - i;
+                i = run;
+            }
+        }
+        return counts;
+    }
+
+    typedef QList<QStringList> BandRows;
 
-                    tileOffset += tileParts * map->tileWidth();
-                    checkedIndex += tileParts;
+    /**
+     * Function formats the rows of a band one string each
+     */
+    QStringList formatBandRows(const RowBand &band)
+    {
+        QStringList rows;
+        const int width = band.grid->width();
+        for (int j = band.top; j < band.bottom; ++j)
+        {
+            QString row;
+            QTextStream stream(&row);
+            const int *cells = band.grid->constRow(j);
+            for (int i = 0; i < width; ++i)
+                stream << cells[i] << (i == width - 1 ? "\\n" : ",");
+            stream.flush();
+            rows.append(row);
+        }
+        return rows;
+    }
+}
 
+AS3Level::AS3Level()
+    : spriteListThreshold(0),
+      mergeLayers(false),
+      solidCoverageThreshold(0),
+      frequencyOrder(false),
+      lazyTilemaps(false),
+      minimaps(false),
+      largeTileSprites(false),
+      loadStats(false),
+      usageReport(NULL),
+      progressListener(NULL),
+      classOutput(true)
+{
+    loadBlueprint();
+}
+
+void AS3Level::saveLayerTilesheet(const QString &fileName,
+                                  const CompactMap *map,
+                                  const TileIdMap &idMap
+                                  ) const
+{
+    // index 0 = NULL
+    // IDs count tile parts, so a tile's strip starts at its ID * tileWidth
+    unsigned int imageWidth = map->tileWidth;     // initial empty tile for flixel
+    foreach (const TileIndex &index, idMap)
+        imageWidth += index.xParts * index.yParts * map->tileWidth;
+
+    // the sheet only depends on its size and on which tile image is placed
+    // where, so identical sheets from earlier exports need no encoding
+    QByteArray signatureData;
+    QDataStream signature(&signatureData, QIODevice::WriteOnly);
+    signature << imageWidth << map->tileWidth << map->tileHeight;
+    for (TileIdMap::const_iterator it = idMap.constBegin(); it != idMap.constEnd(); ++it)
+    {
+        CompactTileset *tileset = map->tilesetForGid(it.key());
+        signature << it.value().id << tileset->tileImageKey(it.key() - tileset->firstGid());
+    }
+    QByteArray sheetKey = QCryptographicHash::hash(signatureData, QCryptographicHash::Md5);
 
-                    qDebug() << "Skipping tiles: " << tileParts << "\n";
-                    qDebug() << "Added width: " << tileParts * map->tileWidth() << "\n";
+    QByteArray imageBytes;
+    if (!TileCache::instance()->findEncodedSheet(sheetKey, imageBytes))
+    {
+        // the sheet is composited and encoded one pixel row at a time
+        // straight from the (shared) cached tile parts, so it is never
+        // held as a whole
+        QVector<QImage> sheetParts(imageWidth / map->tileWidth);
+        for (TileIdMap::const_iterator it = idMap.constBegin(); it != idMap.constEnd(); ++it)
+        {
+            CompactTileset *tileset = map->tilesetForGid(it.key());
+            int part = it.value().id;
 
-                    break;  // either this, or have a redundant check for (checkedIndex < idMap[tile]) here
-                }
+            foreach (const QImage &tilePart,
+                     TileCache::instance()->tileParts(tileset, it.key() - tileset->firstGid(),
+                                                      map->tileWidth, map->tileHeight))
+            {
+                sheetParts[part++] = tilePart;
             }
         }
 
-        for (unsigned int y = 0; y < yRatio; ++y)
+        QBuffer imageBuffer(&imageBytes);
+        imageBuffer.open(QIODevice::WriteOnly);
+        PngWriter writer(&imageBuffer, imageWidth, map->tileHeight);
+
+        QVector<QRgb> row(imageWidth);
+        for (int y = 0; y < map->tileHeight; ++y)
         {
-            for (unsigned int x = 0; x < xRatio; ++x, tileOffset += map->tileWidth())
+            row.fill(0);
+            for (int i = 0; i < sheetParts.size(); ++i)
             {
-                int srcX = x * map->tileWidth();
-                int srcY = y * map->tileHeight();
-                QPixmap tilePart = tile->image().copy(srcX, srcY, map->tileWidth(), map->tileHeight());
+                const QImage &part = sheetParts.at(i);
+                if (part.isNull() || y >= part.height()) continue;
 
-                painter.drawPixmap(tileOffset, 0, map->tileWidth(), map->tileHeight(), tilePart);
+                memcpy(row.data() + i * map->tileWidth, part.constScanLine(y),
+                       qMin(part.width(), map->tileWidth) * sizeof(QRgb));
             }
+            writer.writeRow(row.constData());
         }
-//            tile->image().copy()
+
+        if (writer.finish())
+            TileCache::instance()->insertEncodedSheet(sheetKey, imageBytes);
+        else
+            qWarning() << "Could not encode tilesheet " << fileName << "\n";
     }
 
     QString imageFile = QString("%1.png").arg(fileName);
-    pm.toImage().save(imageFile, 0, 100);
+    if (!AtomicFile::writeIfChanged(imageFile, imageBytes))
+        qWarning() << "Could not save tilesheet " << imageFile << "\n";
 }
 
 /**
  * Function generates and saves the ActionScript file
  */
-bool AS3Level::save(const QString &fileName, const Tiled::Map *map) const
+bool AS3Level::save(const QString &fileName, const CompactMap *map) const
 {
-    ProgressDialog pd(NULL);
-    pd.setMaxProgress(map->layers().count() + 1);
-    pd.open();
+    QList<LayerGroup> layerGroups = this->groupLayers(map);
+
+    // every group is exported under the name of its first layer; baked
+    // backgrounds get their images in place of a tilesheet
+    QList<const CompactLayer*> tilesheetLayers;
+    foreach (const LayerGroup &group, layerGroups)
+    {
+        if (!this->isStaticBackground(group.first()))
+            tilesheetLayers.append(group.first());
+    }
+
+    if (this->progressListener)
+        this->progressListener->progressStarted(layerGroups.count() + 1);
 
     QString buffer(this->blueprint);
     QFileInfo targetInfo(fileName);
@@ -159,71 +268,626 @@ bool AS3Level::save(const QString &fileName, const Tiled::Map *map) const
     buffer = buffer.replace(FlxPlaceholders::GEN_BY, "FlxExporter v0.2");
     buffer = buffer.replace(FlxPlaceholders::GEN_DATE, "@todo Insert real date");
 
-    this->generateTilemapDeclarations(map->layers(), buffer);
-    this->generateGfxEmbedStatements(map->layers(), buffer);
-
     QString tileData;
     QString tilemapInitCode;
-    foreach (Tiled::Layer *layer, map->layers())
+    QString layerFunctions;
+    QString extraEmbedStatements;
+    QSet<const CompactLayer*> spriteLayers;
+    QSet<const CompactLayer*> lazyLayers;
+    QSet<const CompactLayer*> largeTileLayers;
+    QStringList preloadedLoaders, queuedLoaders;
+    StringTable strings;
+    QList<ExportedLayer> exportedLayers;
+    QHash<int, int> usageCounts;
+    QList<QPair<QString, QString> > usageImages;
+    foreach (const LayerGroup &group, layerGroups)
     {
-        pd.updateProgress();
-        QApplication::instance()->processEvents();
+        if (this->progressListener)
+            this->progressListener->progressStep();
 
-        if (!layer->isVisible()) continue;
+        const CompactLayer *layer = group.first();
 
-        if (layer->asObjectGroup())
+        // what the other output formats get to see of this group
+        ExportedLayer exported;
+        exported.name = layer->name;
+        exported.varName = this->generateLayerVarName(layer);
+        exported.properties = layer->properties;
+        foreach (const CompactLayer *member, group)
+            exported.layerNames.append(member->name);
+
+        if (this->isStaticBackground(layer))
         {
-            qCritical() << "Object layers not supported yet. Ignoring layer '" << layer->name() << "'\n";
+            QString bakeInitCode;
+            this->bakeLayer(fileName, layer, extraEmbedStatements, bakeInitCode, &exported.images);
+            this->generateLayerInitFunction(layer, bakeInitCode, tilemapInitCode, layerFunctions);
+
+            if (this->usageReport)
+            {
+                TileIdMap unusedIdMap;
+                QHash<int, int> gidCounts;
+                this->generateLayerTileIDMap(group, unusedIdMap, NULL, NULL, &gidCounts);
+                for (QHash<int, int>::const_iterator it = gidCounts.constBegin(); it != gidCounts.constEnd(); ++it)
+                    usageCounts[it.key()] += it.value();
+                foreach (const ExportedImage &image, exported.images)
+                    usageImages.append(qMakePair(layer->name, targetInfo.dir().filePath(image.file)));
+            }
+
+            exported.kind = ExportedLayer::BAKED;
+            exported.bounds = QRect(0, 0, map->width, map->height);
+            exportedLayers.append(exported);
             continue;
         }
 
-        QMap<Tiled::Tile *, int> tileIdMap;
-        this->generateLayerTileIDMap(layer, tileIdMap);
+        // flixel only collides against tilemaps, so collision layers keep
+        // their large tiles split into parts
+        bool extractLargeTiles = this->largeTileSprites
+                && !layer->properties.contains(FlxLayerProperties::COLLISION);
+
+        TileIdMap tileIdMap, largeTiles;
+        int collideIndex;
+        QHash<int, int> gidCounts;
+        this->generateLayerTileIDMap(group, tileIdMap, &collideIndex,
+                                     extractLargeTiles ? &largeTiles : NULL,
+                                     this->usageReport ? &gidCounts : NULL);
         this->saveLayerTilesheet(
             this->generateTilesheetPath(fileName, this->generateLayerVarName(layer)),
             map,
             tileIdMap
         );
-        QTextStream(&tileData) << this->generateTileData(layer, tileIdMap);
-        QTextStream(&tilemapInitCode) << this->generateTilemapInitCode(layer);
+
+        TileGrid grid;
+        this->generateGroupGrid(group, tileIdMap, grid);
+
+        exported.collideIndex = collideIndex;
+        exported.tilesheetFile = QString("gfx/%1.png").arg(exported.varName);
+        exported.tileCount = 1;
+        foreach (const TileIndex &index, tileIdMap)
+            exported.tileCount += index.xParts * index.yParts;
+
+        if (layer->properties.contains(FlxLayerProperties::COLLISION))
+            this->saveNavigationData(fileName, layer, grid, collideIndex, extraEmbedStatements);
+
+        QString largeTileInitCode;
+        if (!largeTiles.isEmpty())
+        {
+            largeTileLayers.insert(layer);
+            largeTileInitCode = this->exportLargeTiles(fileName, group, largeTiles,
+                                                       tileData, extraEmbedStatements, &exported);
+        }
+
+        if (this->usageReport)
+        {
+            for (QHash<int, int>::const_iterator it = gidCounts.constBegin(); it != gidCounts.constEnd(); ++it)
+                usageCounts[it.key()] += it.value();
+            usageImages.append(qMakePair(layer->name, targetInfo.dir().filePath(exported.tilesheetFile)));
+            if (!largeTiles.isEmpty())
+                usageImages.append(qMakePair(layer->name, targetInfo.dir().filePath(exported.largeTileFile)));
+        }
+
+        if (this->isSparseLayer(layer, grid))
+        {
+            qDebug() << "Exporting layer " << layer->name << " as a sprite list\n";
+
+            spriteLayers.insert(layer);
+            QTextStream(&tileData) << this->generateSpriteData(layer, grid);
+            this->generateLayerInitFunction(layer, this->generateSpriteLayerInitCode(layer) + largeTileInitCode,
+                                            tilemapInitCode, layerFunctions);
+
+            exported.kind = ExportedLayer::SPRITE_LIST;
+            exported.bounds = QRect(0, 0, grid.width(), grid.height());
+            exported.tiles = grid;
+            exportedLayers.append(exported);
+            continue;
+        }
+
+        // only the occupied part of the layer is exported; flixel needs
+        // at least one tile even for empty layers
+        QRect bounds = grid.occupiedBounds();
+        if (bounds.isEmpty())
+            bounds = QRect(0, 0, 1, 1);
+
+        exported.bounds = bounds;
+        exported.tiles = grid.copy(bounds);
+        exportedLayers.append(exported);
+
+        QTextStream(&tileData) << this->generateTileData(fileName, layer, exported.tiles);
+        if (layer->properties.contains(FlxLayerProperties::COLLISION))
+            QTextStream(&tileData) << this->generateCollisionPolygons(layer, tileIdMap);
+        QTextStream(&tileData) << this->generateTileProperties(layer, tileIdMap, strings);
+
+        if (!this->lazyTilemaps)
+        {
+            this->generateLayerInitFunction(layer, this->generateTilemapInitCode(layer, bounds, collideIndex)
+                                            + largeTileInitCode,
+                                            tilemapInitCode, layerFunctions);
+            continue;
+        }
+
+        lazyLayers.insert(layer);
+        this->generateLayerInitFunction(layer, this->generateLazyTilemapInitCode(layer) + largeTileInitCode,
+                                        tilemapInitCode, layerFunctions);
+        QTextStream(&layerFunctions) << this->generateLazyTilemapFunctions(layer, bounds, collideIndex);
+
+        QString loader = "load" + this->generateLayerFunctionName(layer);
+        if (layer->properties.contains(FlxLayerProperties::PRELOAD))
+            preloadedLoaders.append(loader);
+        else
+            queuedLoaders.append(loader);
     }
 
+    // load order hint: layers marked 'preload' (e.g., the ones visible
+    // at the spawn point) load with the level, the others on access or
+    // through loadNextTilemap
+    if (!lazyLayers.isEmpty())
+    {
+        foreach (const QString &loader, preloadedLoaders)
+            QTextStream(&tilemapInitCode) << loader << "();\n\t\t\t";
+        QTextStream(&tilemapInitCode)
+                << QString("tilemapLoadQueue = [%1];").arg(queuedLoaders.join(", ")) << "\n\t\t\t";
+        QTextStream(&layerFunctions) << this->generateLoadNextTilemapFunction();
+    }
+
+    if (this->minimaps)
+        this->saveMinimaps(fileName, map, extraEmbedStatements);
+
+    this->generateGfxEmbedStatements(tilesheetLayers, extraEmbedStatements, buffer);
+    this->generateTilemapDeclarations(tilesheetLayers, spriteLayers, lazyLayers, largeTileLayers, buffer);
+
+    QString helperFunctions;
+    if (!spriteLayers.isEmpty() || !largeTileLayers.isEmpty())
+        helperFunctions += this->generateSpriteLayerRenderer();
+    if (!strings.isEmpty())
+    {
+        tileData.prepend(strings.declaration("STRINGS"));
+        helperFunctions += this->generatePropertyLookup();
+    }
+    buffer = buffer.replace(FlxPlaceholders::HELPER_FUNCTIONS, helperFunctions);
     buffer = buffer.replace(FlxPlaceholders::LAYER_TILE_DATA, tileData);
     buffer = buffer.replace(FlxPlaceholders::TILEMAP_INITIALIZATION, tilemapInitCode);
+    buffer = buffer.replace(FlxPlaceholders::LAYER_FUNCTIONS, layerFunctions);
+    this->generateLoadStatsCode(buffer);
+
+    bool saved = !this->classOutput || AtomicFile::writeIfChanged(fileName, buffer.toLatin1());
 
+    if (this->usageReport)
+        this->usageReport->addLevel(fileName, map, usageCounts, usageImages);
 
-    //for (unsigned int i = 0; i < (0-1); ++i)
-    //{
-    //    pd.setProgress(i % 101);
-    //}
-    pd.close();
+    foreach (LevelSink *sink, this->sinks)
+        saved = sink->write(fileName, map, exportedLayers) && saved;
 
-    QByteArray contentBytes(buffer.toLatin1());
-    QFile output(fileName);
-    if (output.open(QIODevice::WriteOnly))
+    if (this->progressListener)
+        this->progressListener->progressFinished();
+
+    return saved;
+}
+
+/**
+ * Function saves overview images of the whole level (see MinimapRenderer)
+ * and embeds them as public constants, e.g. minimap4Gfx for 1/4 scale, so
+ * the game can show them instead of sampling its tilemaps
+ */
+void AS3Level::saveMinimaps(const QString &levelFileName,
+                           const CompactMap *map,
+                           QString &embedStatements) const
+{
+    MinimapRenderer renderer(map);
+    QList<QByteArray> pngs = renderer.render();
+
+    // the gfx directory is shared, so the images carry the level's name
+    QString className = QFileInfo(levelFileName).baseName();
+    for (int i = 0; i < pngs.count(); ++i)
     {
-        output.write(contentBytes);
-        output.flush();
-        output.close();
-        return true;
+        if (pngs.at(i).isEmpty()) continue;
+
+        int scale = MinimapRenderer::scale(i);
+        QString imageName = QString("%1Minimap%2").arg(className).arg(scale);
+
+        QString imageFile = this->generateTilesheetPath(levelFileName, imageName) + ".png";
+        if (!AtomicFile::writeIfChanged(imageFile, pngs.at(i)))
+            qWarning() << "Could not save minimap " << imageFile << "\n";
+
+        QTextStream(&embedStatements)
+                << QString("[Embed(source=\"gfx/%1.png\")]\n\t\t").arg(imageName)
+                << QString("public static const minimap%1Gfx: Class;\n\t\t").arg(scale);
     }
-    return false;
 }
 
-const QString AS3Level::generateTilemapInitCode(const Tiled::Layer *layer) const
+/**
+ * Function generates the code creating a layer's tilemap. The tile data
+ * only covers the given bounds, so the tilemap is moved to their origin.
+ * Tiles from collideIndex on are solid (flixel's default is 1, i.e., all).
+ */
+const QString AS3Level::generateTilemapInitCode(const CompactLayer *layer,
+                                                const QRect &bounds,
+                                                int collideIndex) const
 {
     QString result;
     QString tileMapVar = this->generateLayerVarName(layer) + "Tilemap";
+
+    QTextStream(&result)
+            << QString("%1 = new %2();").arg(tileMapVar, this->tilemapClass) << "\n\t\t\t"
+            << this->generateTilemapLoadCode(layer, tileMapVar, bounds, collideIndex)
+            << QString("add(%1);").arg(tileMapVar) << "\n\t\t\t";
+    return result;
+}
+
+/**
+ * Function generates the code filling an existing tilemap with the
+ * layer's tile data.
+ */
+const QString AS3Level::generateTilemapLoadCode(const CompactLayer *layer,
+                                                const QString &tileMapVar,
+                                                const QRect &bounds,
+                                                int collideIndex) const
+{
+    QString result;
     QString tileDataVar = this->generateLayerVarName(layer) + "TileData";
     QString tileGfxVar = this->generateLayerVarName(layer) + "Gfx";
 
+    if (collideIndex != 1)
+        QTextStream(&result)
+                << QString("%1.collideIndex = %2;").arg(tileMapVar).arg(collideIndex) << "\n\t\t\t";
+
+    if (this->loadStats)
+        QTextStream(&result) << "var loadMapStart: int = getTimer();\n\t\t\t";
+
+    QTextStream(&result)
+            << QString("%1.loadMap(%2, %3);").arg(tileMapVar, tileDataVar, tileGfxVar) << "\n\t\t\t";
+
+    if (this->loadStats)
+        QTextStream(&result)
+                << QString("loadStats.layers[\"%1\"] = { loadMap: getTimer() - loadMapStart, tiles: %2 };")
+                   .arg(this->generateLayerVarName(layer))
+                   .arg(bounds.width() * bounds.height()) << "\n\t\t\t";
+
+    if (bounds.x() != 0)
+        QTextStream(&result)
+                << QString("%1.x = %2;").arg(tileMapVar).arg(bounds.x() * layer->map->tileWidth) << "\n\t\t\t";
+    if (bounds.y() != 0)
+        QTextStream(&result)
+                << QString("%1.y = %2;").arg(tileMapVar).arg(bounds.y() * layer->map->tileHeight) << "\n\t\t\t";
+
+    return result;
+}
+
+/**
+ * Function fills in the load time instrumentation: a static loadStats
+ * object holding the duration of initializeTilemaps and, per layer, of
+ * its loadMap call and its tile count (all durations in milliseconds).
+ * Without the option, the placeholders are removed and no code is left.
+ */
+void AS3Level::generateLoadStatsCode(QString &buffer) const
+{
+    QString imports, declaration, timerStart, timerStop;
+    if (this->loadStats)
+    {
+        // package-level functions only resolve once imported
+        imports = "import flash.utils.getTimer;";
+        declaration = "public static const loadStats: Object = { initializeTilemaps: 0, layers: {} };";
+        timerStart = "var loadStart: int = getTimer();";
+        timerStop = "loadStats.initializeTilemaps = getTimer() - loadStart;";
+    }
+
+    buffer = buffer.replace(FlxPlaceholders::LOAD_STATS_IMPORTS, imports);
+    buffer = buffer.replace(FlxPlaceholders::LOAD_STATS_DECLARATION, declaration);
+    buffer = buffer.replace(FlxPlaceholders::LOAD_TIMER_START, timerStart);
+    buffer = buffer.replace(FlxPlaceholders::LOAD_TIMER_STOP, timerStop);
+}
+
+/**
+ * Function generates the code creating a lazily loaded tilemap: it takes
+ * its place in the draw order right away, but stays non-existent (so it
+ * is neither drawn nor collided with) until its data is loaded.
+ */
+const QString AS3Level::generateLazyTilemapInitCode(const CompactLayer *layer) const
+{
+    QString result;
+    QString tileMapVar = "_" + this->generateLayerVarName(layer) + "Tilemap";
+
     QTextStream(&result)
             << QString("%1 = new %2();").arg(tileMapVar, this->tilemapClass) << "\n\t\t\t"
-            << QString("%1.loadMap(%2, %3);").arg(tileMapVar, tileDataVar, tileGfxVar) << "\n\t\t\t"
+            << QString("%1.exists = false;").arg(tileMapVar) << "\n\t\t\t"
             << QString("add(%1);").arg(tileMapVar) << "\n\t\t\t";
     return result;
 }
 
+/**
+ * Function generates the loader of a lazily loaded tilemap (returning
+ * false if it was loaded before) and the getter that loads it on first
+ * access.
+ */
+const QString AS3Level::generateLazyTilemapFunctions(const CompactLayer *layer,
+                                                     const QRect &bounds,
+                                                     int collideIndex) const
+{
+    QString result;
+    QString varName = this->generateLayerVarName(layer);
+    QString tileMapVar = "_" + varName + "Tilemap";
+    QString loader = "load" + this->generateLayerFunctionName(layer);
+
+    QTextStream(&result)
+            << QString("public function get %1Tilemap(): %2\n\t\t").arg(varName, this->tilemapClass)
+            << "{\n\t\t\t"
+            << loader << "();\n\t\t\t"
+            << "return " << tileMapVar << ";\n\t\t"
+            << "}\n\t\t\n\t\t"
+            << QString("protected function %1(): Boolean\n\t\t").arg(loader)
+            << "{\n\t\t\t"
+            << QString("if (%1.exists) return false;").arg(tileMapVar) << "\n\t\t\t"
+            << this->generateTilemapLoadCode(layer, tileMapVar, bounds, collideIndex)
+            << QString("%1.exists = true;").arg(tileMapVar) << "\n\t\t\t"
+            << "return true;\n\t\t"
+            << "}\n\t\t\n\t\t";
+    return result;
+}
+
+/**
+ * Function generates loadNextTilemap, which loads one queued tilemap per
+ * call so that loading can be spread over several frames
+ */
+const QString AS3Level::generateLoadNextTilemapFunction() const
+{
+    QString result;
+    QTextStream(&result)
+            << "public function loadNextTilemap(): Boolean\n\t\t"
+            << "{\n\t\t\t"
+            << "while (tilemapLoadQueue.length > 0)\n\t\t\t"
+            << "{\n\t\t\t\t"
+            << "var load: Function = tilemapLoadQueue.shift();\n\t\t\t\t"
+            << "if (load()) return true;\n\t\t\t"
+            << "}\n\t\t\t"
+            << "return false;\n\t\t"
+            << "}\n\t\t\n\t\t";
+    return result;
+}
+
+/**
+ * Function puts a layer's initialization code into a function of its own
+ * and appends the call to the constructor code. Small functions keep
+ * levels with many layers clear of AVM2 method size limits.
+ */
+void AS3Level::generateLayerInitFunction(const CompactLayer *layer,
+                                         const QString &initCode,
+                                         QString &callCode,
+                                         QString &functions) const
+{
+    QString function = "init" + this->generateLayerFunctionName(layer);
+
+    QTextStream(&callCode) << function << "();\n\t\t\t";
+    QTextStream(&functions)
+            << QString("protected function %1(): void\n\t\t").arg(function)
+            << "{\n\t\t\t"
+            << initCode.trimmed() << "\n\t\t"
+            << "}\n\t\t\n\t\t";
+}
+
+/**
+ * @return the layer's variable name with the first letter capitalized,
+ *         to follow a verb in function names (e.g., initGround)
+ */
+QString AS3Level::generateLayerFunctionName(const CompactLayer *layer) const
+{
+    QString name = this->generateLayerVarName(layer);
+    name[0] = name[0].toUpper();
+    return name;
+}
+
+
+/**
+ * Function decides whether a layer uses few enough cells to be cheaper
+ * as a list of sprites than as a full tilemap. Sprites are not solid, so
+ * collision layers always stay tilemaps.
+ */
+bool AS3Level::isSparseLayer(const CompactLayer *layer, const TileGrid &grid) const
+{
+    if (layer->properties.contains(FlxLayerProperties::COLLISION))
+        return false;
+
+    int cellCount = grid.width() * grid.height();
+    return grid.occupiedCount() * 100 < cellCount * this->spriteListThreshold;
+}
+
+/**
+ * Function exports the tiles of a layer group that span several cells as
+ * sprites: their images go into an atlas of equal frames (the size of the
+ * largest one) and their cells into a packed (column, row, frame)
+ * placement list, in drawing order.
+ *
+ * @return code creating the layer's large tile sprites
+ */
+const QString AS3Level::exportLargeTiles(const QString &levelFileName,
+                                         const LayerGroup &layers,
+                                         const TileIdMap &largeTiles,
+                                         QString &tileData,
+                                         QString &embedStatements,
+                                         ExportedLayer *exported) const
+{
+    const CompactLayer *layer = layers.first();
+    const CompactMap *map = layer->map;
+    QString varName = this->generateLayerVarName(layer) + "LargeTiles";
+
+    QSize frameSize;
+    for (TileIdMap::const_iterator it = largeTiles.constBegin(); it != largeTiles.constEnd(); ++it)
+    {
+        CompactTileset *tileset = map->tilesetForGid(it.key());
+        frameSize = frameSize.expandedTo(QSize(tileset->tileWidth(), tileset->tileHeight()));
+    }
+
+    this->saveLargeTileAtlas(this->generateTilesheetPath(levelFileName, varName),
+                             map, largeTiles, frameSize);
+
+    QList<ExportedLargeTile> sprites;
+    foreach (const CompactLayer *member, layers)
+    {
+        for (int j = 0; j < member->gids.height(); ++j)
+        {
+            const int *row = member->gids.constRow(j);
+            for (int i = 0; i < member->gids.width(); ++i)
+            {
+                TileIdMap::const_iterator it = row[i] != 0 ? largeTiles.constFind(row[i]) : largeTiles.constEnd();
+                if (it == largeTiles.constEnd()) continue;
+
+                ExportedLargeTile sprite;
+                sprite.cell = QPoint(i, j);
+                sprite.frame = it.value().id;
+                sprites.append(sprite);
+            }
+        }
+    }
+
+    QString placements;
+    QTextStream stream(&placements);
+    for (int i = 0; i < sprites.count(); ++i)
+    {
+        const ExportedLargeTile &sprite = sprites.at(i);
+        stream << (i == 0 ? "" : ",") << sprite.cell.x() << "," << sprite.cell.y() << "," << sprite.frame;
+    }
+    stream.flush();
+
+    if (exported)
+    {
+        exported->largeTileFile = QString("gfx/%1.png").arg(varName);
+        exported->largeTileFrame = frameSize;
+        exported->largeTiles = sprites;
+    }
+
+    QTextStream(&tileData)
+            << QString("protected const %1Data: Array = [%2];\n\t\t").arg(varName, placements);
+
+    QTextStream(&embedStatements)
+            << QString("[Embed(source=\"gfx/%1.png\")]\n\t\t").arg(varName)
+            << "protected static const " << varName << "Gfx: Class;\n\t\t";
+
+    QString result;
+    QTextStream(&result)
+            << QString("%1 = createSpriteLayer(%1Data, %1Gfx, %2, %3, %4, %5);")
+               .arg(varName)
+               .arg(map->tileWidth).arg(map->tileHeight)
+               .arg(frameSize.width()).arg(frameSize.height()) << "\n\t\t\t"
+            << QString("add(%1);").arg(varName) << "\n\t\t\t";
+    return result;
+}
+
+/**
+ * Function saves the frames of a large tile atlas side by side, each tile
+ * anchored at the bottom-left of its frame
+ */
+void AS3Level::saveLargeTileAtlas(const QString &fileName,
+                                  const CompactMap *map,
+                                  const TileIdMap &largeTiles,
+                                  const QSize &frameSize) const
+{
+    QVector<QImage> frames(largeTiles.count());
+    for (TileIdMap::const_iterator it = largeTiles.constBegin(); it != largeTiles.constEnd(); ++it)
+    {
+        CompactTileset *tileset = map->tilesetForGid(it.key());
+        frames[it.value().id] = tileset->tileImage(it.key() - tileset->firstGid())
+                                .convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+
+    const int imageWidth = frames.size() * frameSize.width();
+
+    QByteArray imageBytes;
+    QBuffer imageBuffer(&imageBytes);
+    imageBuffer.open(QIODevice::WriteOnly);
+    PngWriter writer(&imageBuffer, imageWidth, frameSize.height());
+
+    QVector<QRgb> row(imageWidth);
+    for (int y = 0; y < frameSize.height(); ++y)
+    {
+        row.fill(0);
+        for (int i = 0; i < frames.size(); ++i)
+        {
+            const QImage &frame = frames.at(i);
+            int frameY = y - (frameSize.height() - frame.height());
+            if (frame.isNull() || frameY < 0) continue;
+
+            memcpy(row.data() + i * frameSize.width(), frame.constScanLine(frameY),
+                   frame.width() * sizeof(QRgb));
+        }
+        writer.writeRow(row.constData());
+    }
+
+    QString imageFile = QString("%1.png").arg(fileName);
+    if (!writer.finish() || !AtomicFile::writeIfChanged(imageFile, imageBytes))
+        qWarning() << "Could not save large tile atlas " << imageFile << "\n";
+}
+
+/**
+ * Function generates the packed (column, row, tile index) list of the
+ * non-empty cells of a sparse layer.
+ */
+const QString AS3Level::generateSpriteData(const CompactLayer *layer,
+                                           const TileGrid &grid) const
+{
+    QString spriteDataString;
+    QTextStream stream(&spriteDataString);
+
+    bool first = true;
+    for (int j = 0; j < grid.height(); ++j)
+    {
+        const int *row = grid.constRow(j);
+        for (int i = 0; i < grid.width(); ++i)
+        {
+            if (row[i] == 0) continue;
+
+            stream << (first ? "" : ",") << i << "," << j << "," << row[i];
+            first = false;
+        }
+    }
+    stream.flush();
+
+    QString result;
+    QTextStream(&result)
+            << "protected const " << this->generateLayerVarName(layer)
+            << QString("SpriteData: Array = [%1];\n\t\t").arg(spriteDataString);
+
+    return result;
+}
+
+const QString AS3Level::generateSpriteLayerInitCode(const CompactLayer *layer) const
+{
+    QString result;
+    QString spritesVar = this->generateLayerVarName(layer) + "Sprites";
+    QString spriteDataVar = this->generateLayerVarName(layer) + "SpriteData";
+    QString tileGfxVar = this->generateLayerVarName(layer) + "Gfx";
+
+    QTextStream(&result)
+            << QString("%1 = createSpriteLayer(%2, %3, %4, %5, %4, %5);")
+               .arg(spritesVar, spriteDataVar, tileGfxVar)
+               .arg(layer->map->tileWidth)
+               .arg(layer->map->tileHeight) << "\n\t\t\t"
+            << QString("add(%1);").arg(spritesVar) << "\n\t\t\t";
+    return result;
+}
+
+/**
+ * Function generates the function that turns a sprite list into a group
+ * of inactive sprites, each showing one frame of a tilesheet. Frames may
+ * be bigger than a cell; like in Tiled, they are anchored at the
+ * bottom-left of their cell.
+ */
+const QString AS3Level::generateSpriteLayerRenderer() const
+{
+    QString result;
+    QTextStream(&result)
+            << "protected function createSpriteLayer(Data: Array, Graphic: Class, TileWidth: uint, TileHeight: uint,\n\t\t\t"
+            << "FrameWidth: uint, FrameHeight: uint): FlxGroup\n\t\t"
+            << "{\n\t\t\t"
+            << "var group: FlxGroup = new FlxGroup();\n\t\t\t"
+            << "for (var i: uint = 0; i < Data.length; i += 3)\n\t\t\t"
+            << "{\n\t\t\t\t"
+            << "var sprite: FlxSprite = new FlxSprite(Data[i] * TileWidth, (Data[i + 1] + 1) * TileHeight - FrameHeight);\n\t\t\t\t"
+            << "sprite.loadGraphic(Graphic, true, false, FrameWidth, FrameHeight);\n\t\t\t\t"
+            << "sprite.frame = Data[i + 2];\n\t\t\t\t"
+            << "sprite.active = false;\n\t\t\t\t"
+            << "sprite.solid = false;\n\t\t\t\t"
+            << "group.add(sprite);\n\t\t\t"
+            << "}\n\t\t\t"
+            << "return group;\n\t\t"
+            << "}\n\t\t";
+    return result;
+}
 
 QString AS3Level::generateTilesheetPath(const QString &levelFileName,
                                      const QString &sheetFileName) const
@@ -235,42 +899,489 @@ QString AS3Level::generateTilesheetPath(const QString &levelFileName,
     return targetDir.filePath(sheetFileName);
 }
 
-void AS3Level::generateLayerTileIDMap(Tiled::Layer *layer, QMap<Tiled::Tile *, int> &idMap) const
+/**
+ * Function splits the exported (visible tile) layers into groups that
+ * are exported as one tilemap each.
+ *
+ * With layer merging enabled, a run of neighbouring layers is grouped as
+ * long as none of their used cells overlap; draw order is therefore never
+ * affected. Layers with a distinct role (e.g., collision) stay on their own.
+ */
+QList<LayerGroup> AS3Level::groupLayers(const CompactMap *map) const
+{
+    QList<LayerGroup> groups;
+    TileGrid groupCoverage;
+    bool groupMergeable = false;
+
+    foreach (const CompactLayer *layer, map->layers)
+    {
+        if (!layer->visible) continue;
+
+        LayerGroup single;
+        single.append(layer);
+
+        if (!this->mergeLayers || this->hasDistinctRole(layer))
+        {
+            groups.append(single);
+            groupMergeable = false;
+            continue;
+        }
+
+        TileIdMap idMap;
+        TileGrid coverage;
+        this->generateLayerTileIDMap(single, idMap);
+        this->generateLayerGrid(layer, idMap, coverage);
+
+        if (groupMergeable && !groupCoverage.overlaps(coverage))
+        {
+            qDebug() << "Merging layer " << layer->name
+                     << " into " << groups.last().first()->name << "\n";
+
+            groups.last().append(layer);
+            groupCoverage.overlay(coverage);
+        }
+        else
+        {
+            groups.append(single);
+            groupCoverage = coverage;
+            groupMergeable = true;
+        }
+    }
+
+    return groups;
+}
+
+/**
+ * @return true if the layer is marked with a custom property that requires
+ *         it to be exported separately
+ */
+bool AS3Level::hasDistinctRole(const CompactLayer *layer) const
+{
+    return layer->properties.contains(FlxLayerProperties::COLLISION)
+            || this->isStaticBackground(layer);
+}
+
+bool AS3Level::isStaticBackground(const CompactLayer *layer) const
+{
+    return layer->properties.contains(FlxLayerProperties::STATIC_BACKGROUND);
+}
+
+/**
+ * Function pre-renders a static background layer into chunk images and
+ * generates the code placing them as sprites.
+ */
+void AS3Level::bakeLayer(const QString &levelFileName,
+                         const CompactLayer *layer,
+                         QString &embedStatements,
+                         QString &initCode,
+                         QList<ExportedImage> *images) const
 {
-    unsigned int index = 0;
+    bool validSize;
+    int chunkSize = layer->properties.value(FlxLayerProperties::STATIC_BACKGROUND).toInt(&validSize);
+    if (!validSize || chunkSize <= 0)
+        chunkSize = BackgroundBaker::DEFAULT_CHUNK_SIZE;
+
+    BackgroundBaker baker(layer, chunkSize);
+
+    // only the chunks around cells changed since the previous export of
+    // the layer are rendered again
+    QString snapshotKey = ExportSnapshots::key(levelFileName, layer->name);
+    BakeSnapshot snapshot;
+    QList<BakedChunk> chunks;
+    if (ExportSnapshots::instance()->findBake(snapshotKey, snapshot)
+        && snapshot.signature == baker.signature())
+    {
+        QRect cells = layer->gids.differingBounds(snapshot.gids);
+        if (!cells.isNull())
+        {
+            // tiles reach up and to the right of their cell
+            int maxTileWidth = layer->map->tileWidth, maxTileHeight = layer->map->tileHeight;
+            foreach (CompactTileset *tileset, layer->map->tilesets)
+            {
+                maxTileWidth = qMax(maxTileWidth, tileset->tileWidth());
+                maxTileHeight = qMax(maxTileHeight, tileset->tileHeight());
+            }
 
+            QRect dirty(cells.x() * layer->map->tileWidth,
+                        (cells.y() + 1) * layer->map->tileHeight - maxTileHeight,
+                        (cells.width() - 1) * layer->map->tileWidth + maxTileWidth,
+                        (cells.height() - 1) * layer->map->tileHeight + maxTileHeight);
+            chunks = baker.rebake(snapshot.chunks, dirty);
+        }
+        else
+        {
+            chunks = snapshot.chunks;
+        }
+    }
+    else
+    {
+        chunks = baker.bake();
+    }
+
+    snapshot.gids = layer->gids;
+    snapshot.signature = baker.signature();
+    snapshot.chunks = chunks;
+    ExportSnapshots::instance()->insertBake(snapshotKey, snapshot);
+
+    QString varName = this->generateLayerVarName(layer);
+    for (int i = 0; i < chunks.count(); ++i)
+    {
+        const BakedChunk &chunk = chunks.at(i);
+        QString chunkName = QString("%1Bake%2").arg(varName).arg(i);
+
+        QString imageFile = this->generateTilesheetPath(levelFileName, chunkName) + ".png";
+        if (!AtomicFile::writeIfChanged(imageFile, chunk.png))
+            qWarning() << "Could not save baked background " << imageFile << "\n";
+
+        QTextStream(&embedStatements)
+                << QString("[Embed(source=\"gfx/%1.png\")]\n\t\t").arg(chunkName)
+                << "protected static const " << chunkName << "Gfx: Class;\n\t\t";
+
+        QTextStream(&initCode)
+                << QString("add(new FlxSprite(%1, %2, %3Gfx)).active = false;")
+                   .arg(chunk.rect.x()).arg(chunk.rect.y()).arg(chunkName) << "\n\t\t\t";
+
+        if (images)
+        {
+            ExportedImage image;
+            image.rect = chunk.rect;
+            image.file = QString("gfx/%1.png").arg(chunkName);
+            images->append(image);
+        }
+    }
+}
+
+/**
+ * Function fills the grid with the combined tile indices of a layer group
+ * (the layers are known not to overlap).
+ */
+void AS3Level::generateGroupGrid(const LayerGroup &layers,
+                                 const TileIdMap &idMap,
+                                 TileGrid &grid) const
+{
+    this->generateLayerGrid(layers.first(), idMap, grid);
+
+    for (int i = 1; i < layers.count(); ++i)
+    {
+        TileGrid layerGrid;
+        this->generateLayerGrid(layers.at(i), idMap, layerGrid);
+        grid.overlay(layerGrid);
+    }
+}
+
+/**
+ * Function assigns flixel tile IDs to every tile used in the layers.
+ * Fully transparent tiles get no ID and are exported as empty cells.
+ *
+ * IDs follow tileset order and tile id (i.e., GID order) rather than
+ * the order tiles are first encountered in, so that two exports of an
+ * unchanged map (or of a map where tiles were only moved around) produce
+ * identical tilesheets and tile data.
+ *
+ * Solid tiles get the IDs after all non-solid ones, so a single
+ * FlxTilemap.collideIndex (the first solid ID) separates them. All parts
+ * of a multi-part tile share its solidity and stay consecutive.
+ *
+ * With frequency ordering, tiles used in more cells get smaller IDs
+ * within each of the two ranges (ties keep GID order), which shortens
+ * the tile data.
+ *
+ * If largeTiles is given, tiles spanning more than one cell go there
+ * instead, numbered from 0 as frames of a large tile atlas; the grid
+ * then only holds cell-sized tiles.
+ *
+ * If gidUsage is given, it receives the number of cells using each GID.
+ */
+void AS3Level::generateLayerTileIDMap(const LayerGroup &layers,
+                                      TileIdMap &idMap,
+                                      int *collideIndex,
+                                      TileIdMap *largeTiles,
+                                      QHash<int, int> *gidUsage) const
+{
     idMap.clear();
-    idMap[NULL] = index++;
+    if (largeTiles)
+        largeTiles->clear();
+
+    // huge layers are scanned in row bands on all cores; the band tables
+    // are merged in band order, and the result is sorted below anyway
+    QList<RowBand> bands;
+    foreach (const CompactLayer *layer, layers)
+        appendRowBands(layer->gids, bands);
+
+    GidCounts gidCounts;
+    QList<GidCounts> bandCounts = QtConcurrent::blockingMapped<QList<GidCounts> >(bands, countBandGids);
+    foreach (const GidCounts &counts, bandCounts)
+    {
+        for (GidCounts::const_iterator it = counts.constBegin(); it != counts.constEnd(); ++it)
+            gidCounts[it.key()] += it.value();
+    }
+
+    if (gidUsage)
+        *gidUsage = gidCounts;
+
+    QList<int> gids = gidCounts.keys();
+    qSort(gids);
+
+    const CompactMap *map = layers.first()->map;
+
+    QList<int> passable, solid;
+    foreach (int gid, gids)
+    {
+        CompactTileset *tileset = map->tilesetForGid(gid);
+        if (tileset == NULL)
+        {
+            qWarning() << "No tileset for GID " << gid << ", exporting as empty\n";
+            continue;
+        }
+        if (TileCache::instance()->isTransparent(tileset, gid - tileset->firstGid()))
+            continue;
+
+        if (this->isSolidTile(tileset, gid - tileset->firstGid()))
+            solid.append(gid);
+        else
+            passable.append(gid);
+    }
+
+    if (this->frequencyOrder)
+    {
+        qStableSort(passable.begin(), passable.end(), MoreFrequent(gidCounts));
+        qStableSort(solid.begin(), solid.end(), MoreFrequent(gidCounts));
+    }
+
+    int index = 1;     // 0 = NULL
+    int largeTileIndex = 0;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        if (pass == 1 && collideIndex)
+            *collideIndex = index;
+
+        foreach (int gid, pass == 0 ? passable : solid)
+        {
+            CompactTileset *tileset = map->tilesetForGid(gid);
+
+            TileIndex tileIndex;
+            tileIndex.id = index;
+            tileIndex.xParts = tileset->tileWidth() / map->tileWidth;
+            tileIndex.yParts = tileset->tileHeight() / map->tileHeight;
+
+            if (largeTiles && tileIndex.xParts * tileIndex.yParts > 1)
+            {
+                tileIndex.id = largeTileIndex++;
+                largeTiles->insert(gid, tileIndex);
+                continue;
+            }
+
+            idMap.insert(gid, tileIndex);
+            index += tileIndex.xParts * tileIndex.yParts;
+        }
+    }
+}
+
+/**
+ * Function classifies a tile by its 'solid' property or, if it has none,
+ * by the share of its opaque pixels.
+ */
+bool AS3Level::isSolidTile(CompactTileset *tileset, int id) const
+{
+    QMap<QString, QString> properties = tileset->tileProperties(id);
+    if (properties.contains(FlxTileProperties::SOLID))
+    {
+        QString value = properties.value(FlxTileProperties::SOLID).trimmed().toLower();
+        return value != "false" && value != "0";
+    }
+
+    if (this->solidCoverageThreshold <= 0)
+        return true;
+
+    return TileCache::instance()->opaqueCoverage(tileset, id) * 100 >= this->solidCoverageThreshold;
+}
+
+/**
+ * Function saves the walkability and region labels of a collision layer
+ * (see NavGrid::toBinary for the format) and embeds them as <layer>Nav.
+ */
+void AS3Level::saveNavigationData(const QString &levelFileName,
+                                  const CompactLayer *layer,
+                                  const TileGrid &grid,
+                                  int collideIndex,
+                                  QString &embedStatements) const
+{
+    NavGrid navGrid(grid, collideIndex);
+
+    QString navName = this->generateLayerVarName(layer) + "Nav";
+    QString navFile = this->generateTilesheetPath(levelFileName, navName) + ".bin";
+    if (!AtomicFile::writeIfChanged(navFile, navGrid.toBinary()))
+        qWarning() << "Could not save navigation data " << navFile << "\n";
+
+    QTextStream(&embedStatements)
+            << QString("[Embed(source=\"gfx/%1.bin\", mimeType=\"application/octet-stream\")]\n\t\t").arg(navName)
+            << "protected static const " << navName << ": Class;\n\t\t";
+}
+
+/**
+ * Function generates the custom properties of a tilemap's tiles.
+ *
+ * Names and values are interned into the level's string table, so every
+ * distinct string appears once however many tiles use it. The properties
+ * array holds (name, value) string index pairs; the offsets array, indexed
+ * by tile ID, gives the span of each tile's pairs (see getTileProperty).
+ * All parts of a multi-part tile share its properties.
+ */
+const QString AS3Level::generateTileProperties(const CompactLayer *layer,
+                                               const TileIdMap &idMap,
+                                               StringTable &strings) const
+{
+    const CompactMap *map = layer->map;
 
-    Tiled::TileLayer *tileLayer = layer->asTileLayer();
-    if (!tileLayer)
+    int idCount = 1;
+    foreach (const TileIndex &index, idMap)
+        idCount = qMax(idCount, index.id + index.xParts * index.yParts);
+
+    QVector<QMap<QString, QString> > tileProperties(idCount);
+    bool found = false;
+    for (TileIdMap::const_iterator it = idMap.constBegin(); it != idMap.constEnd(); ++it)
     {
-        qFatal("generateLayerTileIDMap: received invalid (non-tile) layer\n");
+        CompactTileset *tileset = map->tilesetForGid(it.key());
+        QMap<QString, QString> properties = tileset->tileProperties(it.key() - tileset->firstGid());
+        if (properties.isEmpty()) continue;
+
+        found = true;
+        int parts = it.value().xParts * it.value().yParts;
+        for (int i = 0; i < parts; ++i)
+            tileProperties[it.value().id + i] = properties;
     }
 
-    for (int j = 0; j < tileLayer->height(); ++j)
+    if (!found)
+        return QString();
+
+    QString offsets, pairs;
+    QTextStream offsetStream(&offsets);
+    QTextStream pairStream(&pairs);
+
+    int offset = 0;
+    for (int i = 0; i < idCount; ++i)
     {
-        for (int i = 0; i < tileLayer->width(); ++i)
+        offsetStream << offset << ",";
+
+        const QMap<QString, QString> &properties = tileProperties.at(i);
+        for (QMap<QString, QString>::const_iterator it = properties.constBegin();
+             it != properties.constEnd(); ++it)
         {
-            Tiled::Tile *tile = tileLayer->tileAt(i, j);
+            pairStream << (offset == 0 ? "" : ",")
+                       << strings.intern(it.key()) << "," << strings.intern(it.value());
+            offset += 2;
+        }
+    }
+    offsetStream << offset;
+    offsetStream.flush();
+    pairStream.flush();
+
+    QString varName = this->generateLayerVarName(layer);
+    QString result;
+    QTextStream(&result)
+            << "protected const " << varName
+            << QString("PropertyOffsets: Array = [%1];\n\t\t").arg(offsets)
+            << "protected const " << varName
+            << QString("Properties: Array = [%1];\n\t\t").arg(pairs);
+
+    return result;
+}
+
+/**
+ * Function generates the lookup of a tile property in the packed arrays
+ * written by generateTileProperties
+ */
+const QString AS3Level::generatePropertyLookup() const
+{
+    QString result;
+    QTextStream(&result)
+            << "protected function getTileProperty(Offsets: Array, Properties: Array, TileIndex: uint, Name: String): String\n\t\t"
+            << "{\n\t\t\t"
+            << "if (TileIndex + 1 >= Offsets.length) return null;\n\t\t\t"
+            << "for (var i: uint = Offsets[TileIndex]; i < Offsets[TileIndex + 1]; i += 2)\n\t\t\t"
+            << "{\n\t\t\t\t"
+            << "if (STRINGS[Properties[i]] == Name) return STRINGS[Properties[i + 1]];\n\t\t\t"
+            << "}\n\t\t\t"
+            << "return null;\n\t\t"
+            << "}\n\t\t";
+    return result;
+}
 
-            int xTileParts = tile != NULL ? tile->width() / layer->map()->tileWidth() : 1;
-            int yTileParts = tile != NULL ? tile->height() / layer->map()->tileHeight() : 1;
-            unsigned int tileParts = xTileParts * yTileParts;
+/**
+ * Function generates the collision outlines of partially opaque tiles
+ * (slopes, rounded edges) of a collision layer.
+ *
+ * Outlines are traced once per tile part, i.e., per tile ID, and packed
+ * into one vertex array of x, y pairs in tile pixel coordinates. The
+ * offsets array is indexed by tile ID: the outline of ID i spans
+ * PolygonVertices[PolygonOffsets[i]] to PolygonVertices[PolygonOffsets[i + 1]].
+ * Empty and fully opaque tiles have no outline (an empty span).
+ */
+const QString AS3Level::generateCollisionPolygons(const CompactLayer *layer,
+                                                  const TileIdMap &idMap) const
+{
+    const CompactMap *map = layer->map;
+
+    int idCount = 1;
+    foreach (const TileIndex &index, idMap)
+        idCount = qMax(idCount, index.id + index.xParts * index.yParts);
 
-            if (!idMap.keys().contains(tile))
+    QVector<QPolygon> outlines(idCount);
+    bool found = false;
+    for (TileIdMap::const_iterator it = idMap.constBegin(); it != idMap.constEnd(); ++it)
+    {
+        CompactTileset *tileset = map->tilesetForGid(it.key());
+        int id = it.value().id;
+
+        foreach (const QImage &part,
+                 TileCache::instance()->tileParts(tileset, it.key() - tileset->firstGid(),
+                                                  map->tileWidth, map->tileHeight))
+        {
+            qreal coverage = TileCache::opaqueCoverage(part);
+            if (coverage > 0 && coverage < 1)
             {
-                idMap[tile] = index;
-                index += tileParts;
+                outlines[id] = TileOutline::simplify(TileOutline::trace(part));
+                found = true;
             }
+            ++id;
         }
     }
-    idMap.remove(NULL);
+
+    if (!found)
+        return QString();
+
+    QString offsets, vertices;
+    QTextStream offsetStream(&offsets);
+    QTextStream vertexStream(&vertices);
+
+    int offset = 0;
+    for (int i = 0; i < idCount; ++i)
+    {
+        offsetStream << offset << ",";
+        foreach (const QPoint &vertex, outlines.at(i))
+        {
+            vertexStream << (offset == 0 ? "" : ",") << vertex.x() << "," << vertex.y();
+            offset += 2;
+        }
+    }
+    offsetStream << offset;
+    offsetStream.flush();
+    vertexStream.flush();
+
+    QString varName = this->generateLayerVarName(layer);
+    QString result;
+    QTextStream(&result)
+            << "protected const " << varName
+            << QString("PolygonOffsets: Array = [%1];\n\t\t").arg(offsets)
+            << "protected const " << varName
+            << QString("PolygonVertices: Array = [%1];\n\t\t").arg(vertices);
+
+    return result;
 }
 
-QString AS3Level::generateLayerVarName(const Tiled::Layer *layer) const
+QString AS3Level::generateLayerVarName(const CompactLayer *layer) const
 {
-    QString useName = layer->name().toAscii();
+    QString useName = layer->name.toAscii();
     useName[0] = useName[0].toLower();
     if (!useName[0].isLetter() && useName[0] != '_')
         useName = "_" + useName;
@@ -283,65 +1394,106 @@ QString AS3Level::generateLayerVarName(const Tiled::Layer *layer) const
 }
 
 /**
- * Function generates tile index string for a given layer
- * that is used by FlxTilemap.loadMap.
+ * Function fills the grid with flixel tile indices for a given layer.
  *
- * @todo Fix issue with non-standard size tiles overlapping
- *       borders of map.
+ * Tiles bigger than the map grid are split into parts; a tile is anchored
+ * at its bottom-left cell and its parts spread up and to the right.
+ * Parts falling outside the map are dropped.
  */
-const QString AS3Level::generateTileData(Tiled::Layer *layer,
-                                const QMap<Tiled::Tile *, int> idMap) const
+void AS3Level::generateLayerGrid(const CompactLayer *layer,
+                                 const TileIdMap &idMap,
+                                 TileGrid &grid) const
 {
-    QString tileDataString;
-    QList<int> tileData;
-
-    const int maxLength = layer->height() * layer->width();
+    const TileGrid &gids = layer->gids;
+    grid = TileGrid(gids.width(), gids.height());
 
     int xTileParts;
-    for (int j = 0; j < layer->height(); ++j)
+    for (int j = 0; j < gids.height(); ++j)
     {
-        for (int i = 0; i < layer->width(); i += xTileParts)
+        const int *row = gids.constRow(j);
+        for (int i = 0; i < gids.width(); i += xTileParts)
         {
-            Tiled::Tile* tile = layer->asTileLayer()->tileAt(i, j);
+            // empty cells and tiles without an ID (e.g., fully transparent
+            // ones) leave the grid untouched
+            TileIdMap::const_iterator it = row[i] != 0 ? idMap.constFind(row[i]) : idMap.constEnd();
+            if (it == idMap.constEnd())
+            {
+                xTileParts = 1;
+                continue;
+            }
 
-            xTileParts = tile != NULL ? tile->width() / layer->map()->tileWidth() : 1;
-            int yTileParts = tile != NULL ? tile->height() / layer->map()->tileHeight() : 1;
-            int id = idMap[tile];
+            int id = it.value().id;
+            xTileParts = it.value().xParts;
+            int yTileParts = it.value().yParts;
 
             for (int l = yTileParts - 1; l >= 0; --l)
             {
-                int negativeOffset = l * layer->width();
-                const int indexBase = tileData.length();
                 for (int k = 0; k < xTileParts; ++k, ++id)
                 {
-                    int index = indexBase - negativeOffset + k;
-
-                    if (index < tileData.length())
-                    {
-                        tileData[index] = id;
-                    }
-                    else if (index < maxLength)
-                    {
-                        tileData.append(id);
-                    }
+                    if (grid.contains(i + k, j - l))
+                        grid.set(i + k, j - l, id);
                 }
             }
-            /*QTextStream(&tileData)
-                    << idMap[layer->asTileLayer()->tileAt(i, j)]
-                    << (i < (layer->width() - 1) ? "," : "");*/
         }
-        //if (j != (layer->height() - 1))
-        //    QTextStream(&tileData) << "\\n";
+    }
+}
+
+/**
+ * Function generates tile index string for a given (possibly cropped) grid
+ * that is used by FlxTilemap.loadMap.
+ */
+const QString AS3Level::generateTileData(const QString &levelFileName,
+                                         const CompactLayer *layer,
+                                         const TileGrid &grid) const
+{
+    // rows unchanged since the previous export of the layer are reused;
+    // the others are formatted in parallel bands, which gives exactly the
+    // text a single pass would
+    QString snapshotKey = ExportSnapshots::key(levelFileName, layer->name);
+    TileDataSnapshot snapshot;
+    bool reuse = ExportSnapshots::instance()->findTileData(snapshotKey, snapshot)
+            && snapshot.grid.width() == grid.width()
+            && snapshot.grid.height() == grid.height();
+
+    QList<RowBand> bands;
+    if (!reuse)
+    {
+        snapshot.rows.clear();
+        for (int j = 0; j < grid.height(); ++j)
+            snapshot.rows.append(QString());
+        appendRowBands(grid, bands);
+    }
+    else
+    {
+        for (int j = 0; j < grid.height(); )
+        {
+            if (grid.rowEquals(snapshot.grid, j))
+            {
+                ++j;
+                continue;
+            }
+
+            RowBand band;
+            band.grid = &grid;
+            band.top = j;
+            while (j < grid.height() && !grid.rowEquals(snapshot.grid, j)) ++j;
+            band.bottom = j;
+            bands.append(band);
+        }
     }
 
-    for (int i = 0; i < tileData.length(); ++i)
+    BandRows bandRows = QtConcurrent::blockingMapped<BandRows>(bands, formatBandRows);
+    for (int i = 0; i < bands.count(); ++i)
     {
-        bool lastCol = (i > 0) && (((i+1) % layer->width()) == 0);
-        QTextStream(&tileDataString)
-                << tileData[i]
-                << (lastCol ? "\\n" : ",");
+        for (int j = bands.at(i).top; j < bands.at(i).bottom; ++j)
+            snapshot.rows[j] = bandRows.at(i).at(j - bands.at(i).top);
     }
 
+    QString tileDataString = snapshot.rows.join("");
+
+    snapshot.grid = grid;
+    ExportSnapshots::instance()->insertTileData(snapshotKey, snapshot);
+
     QString result;
     QTextStream(&result)
             << "protected const " << this->generateLayerVarName(layer)
@@ -350,15 +1502,13 @@ const QString AS3Level::generateTileData(Tiled::Layer *layer,
     return result;
 }
 
-void AS3Level::generateGfxEmbedStatements(const QList<Tiled::Layer *> &layers, QString &buffer) const
+void AS3Level::generateGfxEmbedStatements(const QList<const CompactLayer *> &layers,
+                                          const QString &extraEmbedStatements,
+                                          QString &buffer) const
 {
-    QString embedStatements;
-    foreach (Tiled::Layer *layer, layers)
+    QString embedStatements(extraEmbedStatements);
+    foreach (const CompactLayer *layer, layers)
     {
-        //! @todo Unify checks for supported layers
-        if (!layer->isVisible() && !layer->asTileLayer()) continue;
-        //if (this->isLayerSupported(layer))
-
         QTextStream(&embedStatements)
                 << QString("[Embed(source=\"gfx/%1.png\")]\n\t\t").arg(this->generateLayerVarName(layer))
                 << "protected static const " << this->generateLayerVarName(layer) << "Gfx: Class;\n\t\t";
@@ -366,19 +1516,32 @@ void AS3Level::generateGfxEmbedStatements(const QList<Tiled::Layer *> &layers, Q
     buffer = buffer.replace(FlxPlaceholders::GFX_EMBED_STATEMENTS, embedStatements);
 }
 
-void AS3Level::generateTilemapDeclarations(const QList<Tiled::Layer *> &layers, QString &buffer) const
+void AS3Level::generateTilemapDeclarations(const QList<const CompactLayer *> &layers,
+                                           const QSet<const CompactLayer*> &spriteLayers,
+                                           const QSet<const CompactLayer*> &lazyLayers,
+                                           const QSet<const CompactLayer*> &largeTileLayers,
+                                           QString &buffer) const
 {
     QString tilemapDeclarations = "";
+    if (!lazyLayers.isEmpty())
+        tilemapDeclarations = "protected var tilemapLoadQueue: Array;\n\t\t";
 
-    foreach (Tiled::Layer * layer, layers)
+    foreach (const CompactLayer *layer, layers)
     {
-        if (!layer->isVisible()) continue;
-        if (!layer->asTileLayer()) continue;
-
         QString varName = this->generateLayerVarName(layer);
-        QTextStream(&tilemapDeclarations)
-                << QString("protected var %1Tilemap: %2;\n\t\t").arg(varName, this->tilemapClass);
-
+        if (spriteLayers.contains(layer))
+            QTextStream(&tilemapDeclarations)
+                    << QString("protected var %1Sprites: FlxGroup;\n\t\t").arg(varName);
+        else if (lazyLayers.contains(layer))
+            QTextStream(&tilemapDeclarations)
+                    << QString("protected var _%1Tilemap: %2;\n\t\t").arg(varName, this->tilemapClass);
+        else
+            QTextStream(&tilemapDeclarations)
+                    << QString("protected var %1Tilemap: %2;\n\t\t").arg(varName, this->tilemapClass);
+
+        if (largeTileLayers.contains(layer))
+            QTextStream(&tilemapDeclarations)
+                    << QString("protected var %1LargeTiles: FlxGroup;\n\t\t").arg(varName);
     }
 
     buffer = buffer.replace(FlxPlaceholders::TILEMAP_DECLARATIONS, tilemapDeclarations);
@@ -389,6 +1552,70 @@ void AS3Level::setPackageName(const QString &packageName)
     this->packageName = packageName;
 }
 
+void AS3Level::setSpriteListThreshold(int percent)
+{
+    this->spriteListThreshold = percent;
+}
+
+void AS3Level::setMergeLayers(bool merge)
+{
+    this->mergeLayers = merge;
+}
+
+void AS3Level::setLazyTilemaps(bool lazy)
+{
+    this->lazyTilemaps = lazy;
+}
+
+void AS3Level::setTileUsageReport(TileUsageReport *report)
+{
+    this->usageReport = report;
+}
+
+void AS3Level::setLoadStats(bool enabled)
+{
+    this->loadStats = enabled;
+}
+
+void AS3Level::setLargeTileSprites(bool enabled)
+{
+    this->largeTileSprites = enabled;
+}
+
+void AS3Level::setMinimaps(bool enabled)
+{
+    this->minimaps = enabled;
+}
+
+void AS3Level::setFrequencyOrder(bool enabled)
+{
+    this->frequencyOrder = enabled;
+}
+
+void AS3Level::setSolidCoverageThreshold(int percent)
+{
+    this->solidCoverageThreshold = percent;
+}
+
+void AS3Level::setProgressListener(ProgressListener *listener)
+{
+    this->progressListener = listener;
+}
+
+/**
+ * Function adds an output format written along with the ActionScript class
+ * from the same layer data (the sink is not owned)
+ */
+void AS3Level::addSink(LevelSink *sink)
+{
+    this->sinks.append(sink);
+}
+
+void AS3Level::setClassOutput(bool enabled)
+{
+    this->classOutput = enabled;
+}
+
 void AS3Level::setTilemapClass(const QString &className)
 {
     this->tilemapClass = className;
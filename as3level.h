@@ -23,14 +23,36 @@
 #define AS3LEVEL_H
 
 #include <QString>
+#include <QSet>
+#include <QMap>
+#include <QHash>
+#include <QSize>
 
-#include "map.h"
-#include "tile.h"
-#include "layer.h"
-#include "tileset.h"
+#include "compactmap.h"
+#include "progresslistener.h"
+#include "tilegrid.h"
+#include "stringtable.h"
+#include "levelsink.h"
+#include "tileusagereport.h"
 
 namespace Flx
 {
+    /**
+     * Flixel tile index assigned to a tile, and the number of map cells
+     * the tile spans horizontally and vertically
+     */
+    struct TileIndex
+    {
+        TileIndex() : id(0), xParts(1), yParts(1) {}
+
+        int id;
+        int xParts;
+        int yParts;
+    };
+
+    typedef QMap<int, TileIndex> TileIdMap;                // keyed by GID
+    typedef QList<const CompactLayer *> LayerGroup;
+
     /**
      * Class encapsulates the logic for generating an ActionScript output file
      */
@@ -44,8 +66,6 @@ namespace Flx
          */
         QString blueprint;
 
-        QMap<const Tiled::Tileset *, int> tilesetFirstGidMap;
-
         /**
          * Package name
          */
@@ -63,32 +83,188 @@ namespace Flx
          */
         void loadBlueprint();
 
-        void generateTilemapDeclarations(const QList<Tiled::Layer*> &layers, QString &buffer) const;
-        void generateGfxEmbedStatements(const QList<Tiled::Layer*> &layers, QString &buffer) const;
+        /**
+         * Percentage of used cells below which a layer is exported as
+         * a sprite list instead of a tilemap (0 = never)
+         */
+        int spriteListThreshold;
 
-        const QString generateTileData(Tiled::Layer* layer,
-                              const QMap<Tiled::Tile *, int> idMap) const;
-        const QString generateTilemapInitCode(const Tiled::Layer *layer) const;
+        /**
+         * Whether neighbouring layers that do not overlap share one tilemap
+         */
+        bool mergeLayers;
 
-        void generateLayerTileIDMap(Tiled::Layer *layer, QMap<Tiled::Tile *, int> &idMap) const;
+        /**
+         * Percentage of opaque pixels from which tiles without a 'solid'
+         * property count as solid (0 = every tile is solid)
+         */
+        int solidCoverageThreshold;
 
-        QString generateLayerVarName(const Tiled::Layer *layer) const;
+        /**
+         * Whether the most used tiles get the smallest IDs
+         */
+        bool frequencyOrder;
+
+        /**
+         * Whether tilemaps are loaded on first access (or through
+         * loadNextTilemap) instead of when the level is created
+         */
+        bool lazyTilemaps;
+
+        /**
+         * Whether downsampled overview images of the level are exported
+         */
+        bool minimaps;
+
+        /**
+         * Whether tiles spanning several cells are exported as sprites
+         * (from an atlas of their own) instead of split into tile parts
+         */
+        bool largeTileSprites;
+
+        /**
+         * Whether the generated class measures its own loading
+         */
+        bool loadStats;
+
+        /**
+         * Report the tile usage of every saved level is added to (not
+         * owned, may be NULL; shared by levels saved in parallel)
+         */
+        TileUsageReport *usageReport;
+
+        /**
+         * Receives progress while saving (not owned, may be NULL)
+         */
+        ProgressListener *progressListener;
+
+        /**
+         * Whether the ActionScript class itself is written (not when the
+         * level only goes into a level pack)
+         */
+        bool classOutput;
+
+        /**
+         * Additional output formats written with the class (not owned)
+         */
+        QList<LevelSink*> sinks;
+
+        void generateTilemapDeclarations(const QList<const CompactLayer*> &layers,
+                                         const QSet<const CompactLayer*> &spriteLayers,
+                                         const QSet<const CompactLayer*> &lazyLayers,
+                                         const QSet<const CompactLayer*> &largeTileLayers,
+                                         QString &buffer) const;
+        void generateGfxEmbedStatements(const QList<const CompactLayer*> &layers,
+                                        const QString &extraEmbedStatements,
+                                        QString &buffer) const;
+
+        void generateLayerGrid(const CompactLayer *layer,
+                               const TileIdMap &idMap,
+                               TileGrid &grid) const;
+        const QString generateTileData(const QString &levelFileName,
+                                       const CompactLayer *layer,
+                                       const TileGrid &grid) const;
+        const QString generateTilemapInitCode(const CompactLayer *layer,
+                                              const QRect &bounds,
+                                              int collideIndex) const;
+        const QString generateTilemapLoadCode(const CompactLayer *layer,
+                                              const QString &tileMapVar,
+                                              const QRect &bounds,
+                                              int collideIndex) const;
+        const QString generateLazyTilemapInitCode(const CompactLayer *layer) const;
+        const QString generateLazyTilemapFunctions(const CompactLayer *layer,
+                                                   const QRect &bounds,
+                                                   int collideIndex) const;
+        const QString generateLoadNextTilemapFunction() const;
+        void generateLoadStatsCode(QString &buffer) const;
+        void generateLayerInitFunction(const CompactLayer *layer,
+                                       const QString &initCode,
+                                       QString &callCode,
+                                       QString &functions) const;
+
+        void saveMinimaps(const QString &levelFileName,
+                          const CompactMap *map,
+                          QString &embedStatements) const;
+
+        bool isStaticBackground(const CompactLayer *layer) const;
+        void bakeLayer(const QString &levelFileName,
+                       const CompactLayer *layer,
+                       QString &embedStatements,
+                       QString &initCode,
+                       QList<ExportedImage> *images = NULL) const;
+
+        bool isSparseLayer(const CompactLayer *layer, const TileGrid &grid) const;
+        const QString generateSpriteData(const CompactLayer *layer,
+                                         const TileGrid &grid) const;
+        const QString generateSpriteLayerInitCode(const CompactLayer *layer) const;
+        const QString generateSpriteLayerRenderer() const;
+
+        const QString exportLargeTiles(const QString &levelFileName,
+                                       const LayerGroup &layers,
+                                       const TileIdMap &largeTiles,
+                                       QString &tileData,
+                                       QString &embedStatements,
+                                       ExportedLayer *exported = NULL) const;
+        void saveLargeTileAtlas(const QString &fileName,
+                                const CompactMap *map,
+                                const TileIdMap &largeTiles,
+                                const QSize &frameSize) const;
+
+        void generateLayerTileIDMap(const LayerGroup &layers,
+                                    TileIdMap &idMap,
+                                    int *collideIndex = NULL,
+                                    TileIdMap *largeTiles = NULL,
+                                    QHash<int, int> *gidUsage = NULL) const;
+        bool isSolidTile(CompactTileset *tileset, int id) const;
+
+        void saveNavigationData(const QString &levelFileName,
+                                const CompactLayer *layer,
+                                const TileGrid &grid,
+                                int collideIndex,
+                                QString &embedStatements) const;
+
+        const QString generateTileProperties(const CompactLayer *layer,
+                                             const TileIdMap &idMap,
+                                             StringTable &strings) const;
+        const QString generatePropertyLookup() const;
+
+        const QString generateCollisionPolygons(const CompactLayer *layer,
+                                                const TileIdMap &idMap) const;
+
+        QList<LayerGroup> groupLayers(const CompactMap *map) const;
+        bool hasDistinctRole(const CompactLayer *layer) const;
+        void generateGroupGrid(const LayerGroup &layers,
+                               const TileIdMap &idMap,
+                               TileGrid &grid) const;
+
+        QString generateLayerVarName(const CompactLayer *layer) const;
+        QString generateLayerFunctionName(const CompactLayer *layer) const;
 
         void saveLayerTilesheet(const QString &fileName,
-                                const Tiled::Map *map,
-                                const QMap<Tiled::Tile*, int> &idMap) const;
+                                const CompactMap *map,
+                                const TileIdMap &idMap) const;
 
         QString generateTilesheetPath(const QString &levelFileName, const QString &sheetFileName) const;
 
     public:
         AS3Level();
 
-        bool save(const QString &fileName, const Tiled::Map *map) const;
+        bool save(const QString &fileName, const CompactMap *map) const;
 
         void setTilemapClass(const QString &className);
         void setPackageName(const QString &packageName);
-
-        void initTilesetGIDmap(const Tiled::Map *map);
+        void setSpriteListThreshold(int percent);
+        void setMergeLayers(bool merge);
+        void setSolidCoverageThreshold(int percent);
+        void setFrequencyOrder(bool enabled);
+        void setLazyTilemaps(bool lazy);
+        void setMinimaps(bool enabled);
+        void setLargeTileSprites(bool enabled);
+        void setLoadStats(bool enabled);
+        void setTileUsageReport(TileUsageReport *report);
+        void setProgressListener(ProgressListener *listener);
+        void addSink(LevelSink *sink);
+        void setClassOutput(bool enabled);
     };
 }
 #endif // AS3LEVEL_H
@@ -3,16 +3,29 @@
 
 namespace FlxPlaceholders
 {
-    const char* TILEMAP_DECLARATIONS = "%tilemapDeclarations%";
-    const char* CLASS_NAME = "%className%";
-    const char* DERIVED_CLASS_NAME = "%derivedClassName%";
-    const char* PACKAGE_NAME = "%packageName%";
-    const char* TILEMAP_CLASS = "%tilemapClass%";
-    const char* GEN_BY = "%generatedBy%";
-    const char* GEN_DATE = "%generationDate%";
-    const char* GFX_EMBED_STATEMENTS = "%gfxEmbedStatements%";
-    const char* LAYER_TILE_DATA = "%layerTileData%";
-    const char* TILEMAP_INITIALIZATION = "%tilemapInitialization%";
+    const char* const TILEMAP_DECLARATIONS = "%tilemapDeclarations%";
+    const char* const CLASS_NAME = "%className%";
+    const char* const DERIVED_CLASS_NAME = "%derivedClassName%";
+    const char* const PACKAGE_NAME = "%packageName%";
+    const char* const TILEMAP_CLASS = "%tilemapClass%";
+    const char* const GEN_BY = "%generatedBy%";
+    const char* const GEN_DATE = "%generationDate%";
+    const char* const GFX_EMBED_STATEMENTS = "%gfxEmbedStatements%";
+    const char* const LAYER_TILE_DATA = "%layerTileData%";
+    const char* const TILEMAP_INITIALIZATION = "%tilemapInitialization%";
+    const char* const LAYER_FUNCTIONS = "%layerFunctions%";
+    const char* const HELPER_FUNCTIONS = "%helperFunctions%";
+    const char* const LOAD_STATS_IMPORTS = "%loadStatsImports%";
+    const char* const LOAD_STATS_DECLARATION = "%loadStatsDeclaration%";
+    const char* const LOAD_TIMER_START = "%loadTimerStart%";
+    const char* const LOAD_TIMER_STOP = "%loadTimerStop%";
+
+    // level pack loader (see LevelPack)
+    const char* const LEVEL_COUNT = "%levelCount%";
+    const char* const PACK_FILE = "%packFile%";
+    const char* const PACK_VERSION = "%packVersion%";
+    const char* const LEVEL_VERSION = "%levelVersion%";
+    const char* const GRAPHICS_TABLE = "%graphicsTable%";
 }
 
 #endif // AS3LEVELPLACEHOLDERS_H
@@ -0,0 +1,111 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryFile>
+#include <QDebug>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <stdio.h>
+#endif
+
+#include "atomicfile.h"
+
+using namespace Flx;
+
+bool AtomicFile::writeIfChanged(const QString &fileName,
+                                const QByteArray &content,
+                                bool *written)
+{
+    if (written) *written = false;
+
+    if (hasContent(fileName, content))
+    {
+        qDebug() << "Unchanged, not rewriting: " << fileName << "\n";
+        return true;
+    }
+
+    // the temporary file has to live in the same directory, otherwise
+    // the rename is a copy and no longer atomic
+    QTemporaryFile tmp(fileName + ".XXXXXX");
+    tmp.setAutoRemove(false);
+    if (!tmp.open())
+    {
+        qWarning() << "Could not create temporary file for " << fileName << "\n";
+        return false;
+    }
+
+    QString tmpName = tmp.fileName();
+    bool ok = (tmp.write(content) == content.size()) && tmp.flush();
+    tmp.close();
+
+    // QTemporaryFile is created owner-only; keep the target's permissions
+    QFileInfo targetInfo(fileName);
+    QFile::setPermissions(tmpName, targetInfo.exists()
+                          ? targetInfo.permissions()
+                          : (QFile::ReadOwner | QFile::WriteOwner | QFile::ReadUser | QFile::WriteUser
+                             | QFile::ReadGroup | QFile::ReadOther));
+
+    if (!ok || !replaceFile(tmpName, fileName))
+    {
+        qWarning() << "Could not write " << fileName << "\n";
+        QFile::remove(tmpName);
+        return false;
+    }
+
+    if (written) *written = true;
+    return true;
+}
+
+/**
+ * Function checks whether the file exists and holds exactly the given bytes
+ */
+bool AtomicFile::hasContent(const QString &fileName, const QByteArray &content)
+{
+    QFileInfo info(fileName);
+    if (!info.exists() || info.size() != content.size())
+        return false;
+
+    QFile existing(fileName);
+    if (!existing.open(QIODevice::ReadOnly))
+        return false;
+
+    return existing.readAll() == content;
+}
+
+/**
+ * Function renames source to target, replacing target in a single step.
+ * QFile::rename refuses to overwrite, so the platform call is used instead.
+ */
+bool AtomicFile::replaceFile(const QString &source, const QString &target)
+{
+#ifdef Q_OS_WIN
+    return MoveFileExW((const wchar_t *) source.utf16(),
+                       (const wchar_t *) target.utf16(),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return ::rename(QFile::encodeName(source).constData(),
+                    QFile::encodeName(target).constData()) == 0;
+#endif
+}
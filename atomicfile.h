@@ -0,0 +1,57 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef ATOMICFILE_H
+#define ATOMICFILE_H
+
+#include <QString>
+#include <QByteArray>
+
+namespace Flx
+{
+    /**
+     * Class writes exported files so that a target is either left untouched
+     * or replaced in one step.
+     *
+     * Unchanged files keep their modification time, which lets incremental
+     * compilers (mxmlc, fcsh) skip them.
+     */
+    class AtomicFile
+    {
+    public:
+        /**
+         * Function replaces fileName with content, unless the file already
+         * holds exactly that content.
+         *
+         * @param written set to true if the file on disk was replaced
+         * @return false if the content could not be written
+         */
+        static bool writeIfChanged(const QString &fileName,
+                                   const QByteArray &content,
+                                   bool *written = 0);
+
+    protected:
+        static bool hasContent(const QString &fileName, const QByteArray &content);
+        static bool replaceFile(const QString &source, const QString &target);
+    };
+}
+
+#endif // ATOMICFILE_H
@@ -0,0 +1,228 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <QPainter>
+#include <QSet>
+#include <QBuffer>
+#include <QFuture>
+#include <QtConcurrentMap>
+#include <QDataStream>
+#include <QtAlgorithms>
+#include <QDebug>
+
+#include "backgroundbaker.h"
+#include "tilecache.h"
+#include "pngwriter.h"
+
+using namespace Flx;
+
+BackgroundBaker::BackgroundBaker(const CompactLayer *layer, int chunkSize)
+    : layer(layer),
+      chunkSize(qBound(1, chunkSize, (int) MAX_CHUNK_SIZE)),
+      tileWidth(layer->map->tileWidth),
+      tileHeight(layer->map->tileHeight),
+      maxTileWidth(layer->map->tileWidth),
+      maxTileHeight(layer->map->tileHeight)
+{
+    QSet<int> skipped;
+    for (int j = 0; j < layer->gids.height(); ++j)
+    {
+        const int *row = layer->gids.constRow(j);
+        for (int i = 0; i < layer->gids.width(); ++i)
+        {
+            int gid = row[i];
+            if (gid == 0 || this->tileImages.contains(gid) || skipped.contains(gid)) continue;
+
+            CompactTileset *tileset = layer->map->tilesetForGid(gid);
+            if (tileset == NULL
+                || TileCache::instance()->isTransparent(tileset, gid - tileset->firstGid()))
+            {
+                skipped.insert(gid);
+                continue;
+            }
+
+            this->tileImages.insert(gid, tileset->tileImage(gid - tileset->firstGid())
+                                    .convertToFormat(QImage::Format_ARGB32_Premultiplied));
+            this->maxTileWidth = qMax(this->maxTileWidth, tileset->tileWidth());
+            this->maxTileHeight = qMax(this->maxTileHeight, tileset->tileHeight());
+        }
+    }
+
+    QDataStream signature(&this->mSignature, QIODevice::WriteOnly);
+    signature << layer->gids.width() << layer->gids.height() << this->tileWidth << this->tileHeight
+              << layer->opacity << this->chunkSize;
+
+    QList<int> gids = this->tileImages.keys();
+    qSort(gids);
+    foreach (int gid, gids)
+    {
+        CompactTileset *tileset = layer->map->tilesetForGid(gid);
+        signature << gid << tileset->tileImageKey(gid - tileset->firstGid());
+    }
+}
+
+QList<BakedChunk> BackgroundBaker::bake() const
+{
+    return this->rebake(QList<BakedChunk>(),
+                        QRect(0, 0,
+                              this->layer->gids.width() * this->tileWidth,
+                              this->layer->gids.height() * this->tileHeight));
+}
+
+QList<BakedChunk> BackgroundBaker::rebake(const QList<BakedChunk> &previous, const QRect &dirty) const
+{
+    QHash<QPair<int, int>, QByteArray> previousPngs;
+    foreach (const BakedChunk &chunk, previous)
+        previousPngs.insert(qMakePair(chunk.rect.x(), chunk.rect.y()), chunk.png);
+
+    const int pixelWidth = this->layer->gids.width() * this->tileWidth;
+    const int pixelHeight = this->layer->gids.height() * this->tileHeight;
+
+    // chunks in order; the dirty ones are filled in once rendered
+    QList<BakedChunk> chunks;
+    QList<ChunkJob> jobs;
+    QList<int> jobChunks;
+
+    for (int y = 0; y < pixelHeight; y += this->chunkSize)
+    {
+        for (int x = 0; x < pixelWidth; x += this->chunkSize)
+        {
+            BakedChunk chunk;
+            chunk.rect = QRect(x, y,
+                               qMin(this->chunkSize, pixelWidth - x),
+                               qMin(this->chunkSize, pixelHeight - y));
+
+            if (chunk.rect.intersects(dirty))
+            {
+                ChunkJob job;
+                job.baker = this;
+                job.rect = chunk.rect;
+                jobs.append(job);
+                jobChunks.append(chunks.count());
+            }
+            else
+            {
+                chunk.png = previousPngs.value(qMakePair(x, y));
+            }
+            chunks.append(chunk);
+        }
+    }
+
+    QFuture<BakedChunk> future = QtConcurrent::mapped(jobs, &BackgroundBaker::renderChunk);
+    future.waitForFinished();
+
+    QList<BakedChunk> rendered = future.results();
+    for (int i = 0; i < rendered.count(); ++i)
+        chunks[jobChunks.at(i)] = rendered.at(i);
+
+    QList<BakedChunk> result;
+    foreach (const BakedChunk &chunk, chunks)
+    {
+        if (!chunk.png.isEmpty())
+            result.append(chunk);
+    }
+    return result;
+}
+
+/**
+ * Function renders and encodes one chunk. The chunk is painted in strips
+ * that are handed to the PNG writer right away, so only one strip of it
+ * is ever held in memory.
+ */
+BakedChunk BackgroundBaker::renderChunk(const ChunkJob &job)
+{
+    const QRect &rect = job.rect;
+
+    BakedChunk chunk;
+    chunk.rect = rect;
+
+    QBuffer buffer(&chunk.png);
+    buffer.open(QIODevice::WriteOnly);
+    PngWriter writer(&buffer, rect.width(), rect.height());
+
+    bool empty = true;
+    for (int top = rect.top(); top <= rect.bottom(); top += STRIP_HEIGHT)
+    {
+        QRect strip(rect.left(), top, rect.width(), qMin((int) STRIP_HEIGHT, rect.bottom() + 1 - top));
+        QImage image(strip.size(), QImage::Format_ARGB32_Premultiplied);
+        image.fill(0);
+
+        if (job.baker->renderStrip(strip, image))
+            empty = false;
+
+        for (int y = 0; y < image.height(); ++y)
+            writer.writeRow(reinterpret_cast<const QRgb *>(image.constScanLine(y)));
+    }
+
+    if (!writer.finish())
+        qWarning() << "Could not encode baked chunk\n";
+
+    if (empty || writer.hasError())
+        chunk.png.clear();
+    return chunk;
+}
+
+/**
+ * Function renders the tiles covering a rectangle of the layer in Tiled's
+ * drawing order (row by row, tiles anchored at the bottom-left of their
+ * cell) into an image of the rectangle's size.
+ *
+ * @return false if no tile touched the rectangle
+ */
+bool BackgroundBaker::renderStrip(const QRect &rect, QImage &image) const
+{
+    // tiles reach up and to the right of their cell, so cells left of and
+    // below the rectangle can still cover it
+    int firstCol = qMax(0, (rect.left() - this->maxTileWidth + this->tileWidth) / this->tileWidth);
+    int lastCol = qMin(this->layer->gids.width() - 1, rect.right() / this->tileWidth);
+    int firstRow = qMax(0, rect.top() / this->tileHeight);
+    int lastRow = qMin(this->layer->gids.height() - 1,
+                       (rect.bottom() + this->maxTileHeight - this->tileHeight) / this->tileHeight);
+
+    bool empty = true;
+    QPainter painter(&image);
+    painter.setOpacity(this->layer->opacity);
+    painter.translate(-rect.topLeft());
+
+    for (int j = firstRow; j <= lastRow; ++j)
+    {
+        const int *row = this->layer->gids.constRow(j);
+        for (int i = firstCol; i <= lastCol; ++i)
+        {
+            QHash<int, QImage>::const_iterator it = this->tileImages.constFind(row[i]);
+            if (it == this->tileImages.constEnd()) continue;
+
+            const QImage &tileImage = it.value();
+            QRect target(i * this->tileWidth,
+                         (j + 1) * this->tileHeight - tileImage.height(),
+                         tileImage.width(),
+                         tileImage.height());
+
+            if (!target.intersects(rect)) continue;
+
+            painter.drawImage(target.topLeft(), tileImage);
+            empty = false;
+        }
+    }
+    painter.end();
+
+    return !empty;
+}
@@ -0,0 +1,120 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef BACKGROUNDBAKER_H
+#define BACKGROUNDBAKER_H
+
+#include <QList>
+#include <QHash>
+#include <QImage>
+#include <QRect>
+#include <QByteArray>
+
+#include "compactmap.h"
+
+namespace Flx
+{
+    /**
+     * Flattened, PNG encoded part of a baked layer
+     */
+    struct BakedChunk
+    {
+        QRect rect;         // in pixels
+        QByteArray png;
+    };
+
+    /**
+     * Class renders a whole tile layer into fixed-size images, so that
+     * static backgrounds can be drawn as a few sprites instead of a tilemap.
+     *
+     * Chunks are rendered and encoded in parallel, a strip of rows at a time.
+     */
+    class BackgroundBaker
+    {
+    public:
+        /**
+         * @param chunkSize chunk edge length in pixels (Flash bitmaps are
+         *                  limited to 2880 pixels, bigger values are clamped)
+         */
+        BackgroundBaker(const CompactLayer *layer, int chunkSize);
+
+        /**
+         * Function renders the layer. Chunks that end up fully transparent
+         * are left out.
+         */
+        QList<BakedChunk> bake() const;
+
+        /**
+         * Function renders only the chunks touching a rectangle (in pixels)
+         * and takes the others from an earlier bake of the layer with the
+         * same signature (chunks missing there were empty)
+         */
+        QList<BakedChunk> rebake(const QList<BakedChunk> &previous, const QRect &dirty) const;
+
+        /**
+         * @return key identifying everything except the cells that the
+         *         chunks depend on: layer size, opacity, chunk size and
+         *         the tile images used
+         */
+        const QByteArray &signature() const { return mSignature; }
+
+        /**
+         * Function paints the layer's part of a rectangle (in pixels) over
+         * the image
+         *
+         * @return false if no tile touched the rectangle
+         */
+        bool renderStrip(const QRect &rect, QImage &image) const;
+
+        static const int DEFAULT_CHUNK_SIZE = 512;
+        static const int MAX_CHUNK_SIZE = 2880;
+
+    protected:
+        struct ChunkJob
+        {
+            const BackgroundBaker *baker;
+            QRect rect;
+        };
+
+        static BakedChunk renderChunk(const ChunkJob &job);
+
+        // rows of a chunk painted (and held) at a time
+        enum { STRIP_HEIGHT = 64 };
+
+        const CompactLayer *layer;
+        int chunkSize;
+        int tileWidth;
+        int tileHeight;
+
+        /**
+         * Tile images by GID, resolved up front; tilesets load lazily and
+         * may only be used from the GUI thread, QImage is safe to paint
+         * from workers
+         */
+        QHash<int, QImage> tileImages;
+        int maxTileWidth;
+        int maxTileHeight;
+
+        QByteArray mSignature;
+    };
+}
+
+#endif // BACKGROUNDBAKER_H
@@ -1,8 +1,10 @@
 package %packageName%
 {
 	import flash.utils.Dictionary;
+	%loadStatsImports%
 	import mx.controls.Alert;
 	import org.flixel.FlxGroup;
+	import org.flixel.FlxSprite;
 	import org.flixel.FlxTilemap;
 	
 	/**
@@ -30,11 +32,14 @@ package %packageName%
 		//{ region Tilemap variable declarations
 		/* Tilemap declarations */
 		%tilemapDeclarations%
+		%loadStatsDeclaration%
 		//} endregion
 		
 		public function %className%() 
 		{
+			%loadTimerStart%
 			initializeTilemaps();
+			%loadTimerStop%
 		}
 		
 		//{ region Initialization functions
@@ -42,6 +47,12 @@ package %packageName%
 		{
 			%tilemapInitialization%
 		}
+		
+		%layerFunctions%
+		//} endregion
+		
+		//{ region Helper functions
+		%helperFunctions%
 		//} endregion
 		
 	}
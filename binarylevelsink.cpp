@@ -0,0 +1,110 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#include <QFileInfo>
+#include <QDir>
+#include <QDataStream>
+#include <QDebug>
+
+#include "atomicfile.h"
+#include "binarylevelsink.h"
+
+using namespace Flx;
+
+namespace
+{
+    void writeString(QDataStream &stream, const QString &string)
+    {
+        QByteArray utf8 = string.toUtf8();
+        stream << quint16(utf8.size());
+        stream.writeRawData(utf8.constData(), utf8.size());
+    }
+}
+
+bool BinaryLevelSink::write(const QString &levelFileName,
+                            const CompactMap *map,
+                            const QList<ExportedLayer> &layers)
+{
+    QFileInfo levelInfo(levelFileName);
+    QString binaryFile = levelInfo.dir().filePath(levelInfo.completeBaseName() + ".bin");
+    if (!AtomicFile::writeIfChanged(binaryFile, encode(map, layers)))
+    {
+        qWarning() << "Could not save " << binaryFile << "\n";
+        return false;
+    }
+    return true;
+}
+
+QByteArray BinaryLevelSink::encode(const CompactMap *map, const QList<ExportedLayer> &layers)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setByteOrder(QDataStream::BigEndian);
+
+    stream.writeRawData("FLXL", 4);
+    stream << VERSION
+           << quint32(map->width) << quint32(map->height)
+           << quint32(map->tileWidth) << quint32(map->tileHeight)
+           << quint32(layers.count());
+
+    foreach (const ExportedLayer &layer, layers)
+    {
+        stream << quint8(layer.kind);
+        writeString(stream, layer.name);
+
+        stream << qint32(layer.bounds.x()) << qint32(layer.bounds.y())
+               << quint32(layer.bounds.width()) << quint32(layer.bounds.height())
+               << quint32(layer.collideIndex) << quint32(layer.tileCount);
+
+        writeString(stream, layer.tilesheetFile);
+        stream << quint32(layer.images.count());
+        foreach (const ExportedImage &image, layer.images)
+        {
+            stream << qint32(image.rect.x()) << qint32(image.rect.y());
+            writeString(stream, image.file);
+        }
+
+        writeString(stream, layer.largeTileFile);
+        stream << quint32(layer.largeTileFrame.width()) << quint32(layer.largeTileFrame.height())
+               << quint32(layer.largeTiles.count());
+        foreach (const ExportedLargeTile &sprite, layer.largeTiles)
+            stream << quint32(sprite.cell.x()) << quint32(sprite.cell.y()) << quint32(sprite.frame);
+
+        if (layer.kind == ExportedLayer::BAKED)
+            continue;
+
+        const bool wide = layer.tileCount > 0xFFFF;
+        for (int j = 0; j < layer.tiles.height(); ++j)
+        {
+            const int *row = layer.tiles.constRow(j);
+            for (int i = 0; i < layer.tiles.width(); ++i)
+            {
+                if (wide)
+                    stream << quint32(row[i]);
+                else
+                    stream << quint16(row[i]);
+            }
+        }
+    }
+
+    return data;
+}
@@ -0,0 +1,69 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef BINARYLEVELSINK_H
+#define BINARYLEVELSINK_H
+
+#include "levelsink.h"
+
+namespace Flx
+{
+    /**
+     * Writes <level>.bin, the level's layers as one big-endian blob
+     * (readable with ActionScript's ByteArray):
+     *
+     *   "FLXL", uint16 version (3)
+     *   uint32 map width, height, tile width, tile height
+     *   uint32 layer count, then per layer:
+     *     uint8 kind (0 = tilemap, 1 = sprite list, 2 = baked)
+     *     string name
+     *     int32 x, y, uint32 width, height (bounds in cells)
+     *     uint32 collideIndex, tile count
+     *     string tilesheet file (empty for baked layers)
+     *     uint32 image count, then per image: int32 x, y (in pixels),
+     *     string file
+     *     string large tile atlas file (empty if none), uint32 frame
+     *     width, height (in pixels), uint32 large tile count, then per
+     *     large tile: uint32 column, row, frame
+     *     width * height tile indices, uint16 each (uint32 if tile count
+     *     exceeds 65535); none for baked layers
+     *
+     * Strings are a uint16 byte count followed by UTF-8, files are
+     * relative to the level file.
+     */
+    class BinaryLevelSink : public LevelSink
+    {
+    public:
+        bool write(const QString &levelFileName,
+                   const CompactMap *map,
+                   const QList<ExportedLayer> &layers);
+
+        /**
+         * @return the level in the format described above
+         */
+        static QByteArray encode(const CompactMap *map, const QList<ExportedLayer> &layers);
+
+        static const quint16 VERSION = 3;
+    };
+}
+
+#endif // BINARYLEVELSINK_H
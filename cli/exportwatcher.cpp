@@ -0,0 +1,300 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#include <QFileInfo>
+#include <QRunnable>
+#include <QScopedPointer>
+#include <QMetaObject>
+#include <QDebug>
+
+#include "tmxreader.h"
+#include "as3level.h"
+#include "tileusagereport.h"
+#include "exportwatcher.h"
+
+using namespace Flx;
+
+namespace
+{
+    /**
+     * Exports one level on a pool thread and reports back to the watcher
+     */
+    class ExportJob : public QRunnable
+    {
+    public:
+        ExportJob(QObject *watcher, const QString &mapFile,
+                  const QString &outputFile, const AS3Level &settings)
+            : watcher(watcher), mapFile(mapFile), outputFile(outputFile), level(settings)
+        {
+        }
+
+        void run()
+        {
+            TmxReader reader;
+            QScopedPointer<CompactMap> map(reader.read(this->mapFile));
+
+            bool success = false;
+            QStringList dependencies;
+            if (map.isNull())
+            {
+                qWarning() << reader.errorString() << "\n";
+            }
+            else
+            {
+                dependencies = TmxReader::dependencies(map.data());
+                success = this->level.save(this->outputFile, map.data());
+            }
+
+            QMetaObject::invokeMethod(this->watcher, "exportFinished", Qt::QueuedConnection,
+                                      Q_ARG(QString, this->mapFile),
+                                      Q_ARG(bool, success),
+                                      Q_ARG(QStringList, dependencies));
+        }
+
+    protected:
+        QObject *watcher;
+        QString mapFile;
+        QString outputFile;
+        AS3Level level;
+    };
+}
+
+ExportWatcher::ExportWatcher(const QString &mapDir,
+                             const QString &outputDir,
+                             const AS3Level &settings,
+                             QObject *parent)
+    : QObject(parent),
+      mapDir(QDir::cleanPath(QDir(mapDir).absolutePath())),
+      outputDir(QDir::cleanPath(QDir(outputDir).absolutePath())),
+      settings(settings),
+      usageReport(NULL)
+{
+    this->settleTimer.setSingleShot(true);
+    this->settleTimer.setInterval(DEFAULT_SETTLE_DELAY);
+
+    connect(&this->settleTimer, SIGNAL(timeout()), this, SLOT(exportSettled()));
+    connect(&this->watcher, SIGNAL(fileChanged(QString)), this, SLOT(fileChanged(QString)));
+    connect(&this->watcher, SIGNAL(directoryChanged(QString)), this, SLOT(directoryChanged(QString)));
+}
+
+void ExportWatcher::setMaxJobs(int jobs)
+{
+    this->pool.setMaxThreadCount(qMax(1, jobs));
+}
+
+void ExportWatcher::setSettleDelay(int msecs)
+{
+    this->settleTimer.setInterval(msecs);
+}
+
+void ExportWatcher::setTileUsageReport(TileUsageReport *report)
+{
+    this->usageReport = report;
+}
+
+/**
+ * Function exports every map of the tree, which also builds the
+ * dependency index and warms the tile cache
+ */
+void ExportWatcher::start()
+{
+    this->scanDirectory(this->mapDir, true);
+    this->exportSettled();
+}
+
+void ExportWatcher::fileChanged(const QString &path)
+{
+    // editors often replace files, which drops them from the watcher
+    if (QFileInfo(path).exists() && !this->watcher.files().contains(path))
+        this->watcher.addPath(path);
+
+    this->changedFiles.insert(path);
+    this->settleTimer.start();
+}
+
+void ExportWatcher::directoryChanged(const QString &path)
+{
+    this->scanDirectory(QDir(path), false);
+    this->settleTimer.start();
+}
+
+/**
+ * Function records new, modified and removed files of a directory as
+ * changed; subdirectories are only scanned when recursive or new.
+ */
+void ExportWatcher::scanDirectory(const QDir &dir, bool recursive)
+{
+    QString dirPath = dir.absolutePath();
+    if (!this->watcher.directories().contains(dirPath))
+    {
+        this->watcher.addPath(dirPath);
+        recursive = true;
+    }
+
+    QSet<QString> present;
+    foreach (const QFileInfo &info, dir.entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        QString path = info.absoluteFilePath();
+        if (info.isDir())
+        {
+            if (recursive || !this->watcher.directories().contains(path))
+                this->scanDirectory(QDir(path), true);
+            continue;
+        }
+
+        present.insert(path);
+
+        QDateTime modified = info.lastModified();
+        if (this->knownFiles.value(path) != modified)
+        {
+            this->knownFiles.insert(path, modified);
+            this->changedFiles.insert(path);
+        }
+
+        if (info.suffix().compare("tmx", Qt::CaseInsensitive) == 0
+            && !this->watcher.files().contains(path))
+        {
+            this->watcher.addPath(path);
+        }
+    }
+
+    QHash<QString, QDateTime>::iterator it = this->knownFiles.begin();
+    while (it != this->knownFiles.end())
+    {
+        if (QFileInfo(it.key()).absolutePath() == dirPath && !present.contains(it.key()))
+        {
+            this->changedFiles.insert(it.key());
+            it = this->knownFiles.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+/**
+ * Function turns the files changed since the last settled moment into
+ * the set of levels to export: changed maps themselves and every map
+ * using a changed tileset or tileset image.
+ */
+void ExportWatcher::exportSettled()
+{
+    QSet<QString> maps;
+    foreach (const QString &path, this->changedFiles)
+    {
+        if (QFileInfo(path).suffix().compare("tmx", Qt::CaseInsensitive) == 0)
+        {
+            if (QFileInfo(path).exists())
+            {
+                maps.insert(path);
+            }
+            else
+            {
+                foreach (const QString &dependency, this->mapDependencies.take(path))
+                    this->dependentMaps[dependency].remove(path);
+                if (this->usageReport)
+                    this->usageReport->removeLevel(this->outputFile(path));
+            }
+        }
+
+        maps += this->dependentMaps.value(path);
+    }
+    this->changedFiles.clear();
+
+    foreach (const QString &map, maps)
+        this->queueExport(map);
+
+    // removed maps have to disappear from the report too
+    if (this->usageReport && this->runningExports.isEmpty())
+        this->usageReport->write(this->outputDir.filePath("usage.txt"));
+}
+
+void ExportWatcher::queueExport(const QString &mapFile)
+{
+    if (this->runningExports.contains(mapFile))
+    {
+        this->staleExports.insert(mapFile);
+        return;
+    }
+
+    QString outputFile = this->outputFile(mapFile);
+    QFileInfo(outputFile).dir().mkpath(".");
+
+    this->runningExports.insert(mapFile);
+    this->pool.start(new ExportJob(this, mapFile, outputFile, this->settings));
+}
+
+void ExportWatcher::exportFinished(const QString &mapFile,
+                                   bool success,
+                                   const QStringList &dependencies)
+{
+    this->runningExports.remove(mapFile);
+
+    if (success)
+    {
+        qDebug() << "Exported " << mapFile << "\n";
+
+        foreach (const QString &dependency, this->mapDependencies.take(mapFile))
+            this->dependentMaps[dependency].remove(mapFile);
+
+        QStringList cleanDependencies;
+        foreach (const QString &dependency, dependencies)
+        {
+            QString path = QDir::cleanPath(dependency);
+            cleanDependencies.append(path);
+            this->dependentMaps[path].insert(mapFile);
+
+            if (QFileInfo(path).exists() && !this->watcher.files().contains(path))
+                this->watcher.addPath(path);
+        }
+        this->mapDependencies.insert(mapFile, cleanDependencies);
+    }
+    else
+    {
+        // the old dependencies stay, so fixing a tileset retries the map
+        qWarning() << "Could not export " << mapFile << "\n";
+    }
+
+    if (this->staleExports.remove(mapFile))
+        this->queueExport(mapFile);
+
+    // a report written while other levels are still exporting would list
+    // tiles only they use as unused
+    if (this->usageReport && this->runningExports.isEmpty())
+        this->usageReport->write(this->outputDir.filePath("usage.txt"));
+}
+
+/**
+ * Function mirrors the map's place in the map tree below the output
+ * directory; the level class is named after the map. Graphics are named
+ * after layers, so every level gets a directory of its own (as in pack
+ * mode) rather than sharing gfx/ with the other maps of its directory.
+ */
+QString ExportWatcher::outputFile(const QString &mapFile) const
+{
+    QFileInfo relative(this->mapDir.relativeFilePath(mapFile));
+    QString name = relative.completeBaseName();
+
+    QDir targetDir(this->outputDir.filePath(relative.path() + "/" + name));
+    return targetDir.filePath(name + ".as");
+}
@@ -0,0 +1,113 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef EXPORTWATCHER_H
+#define EXPORTWATCHER_H
+
+#include <QObject>
+#include <QDir>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QDateTime>
+#include <QTimer>
+#include <QThreadPool>
+#include <QFileSystemWatcher>
+
+namespace Flx
+{
+    class AS3Level;
+    class TileUsageReport;
+
+    /**
+     * Class keeps the levels of a directory tree of maps up to date.
+     *
+     * Every map is exported once on start; afterwards a map is exported
+     * again when it, or a tileset or tileset image it uses, is saved. File
+     * events are collected until nothing has changed for the settle delay,
+     * so editors writing a file in several steps trigger a single export.
+     *
+     * Exports run on a bounded thread pool and share the process-wide
+     * TileCache, so unchanged tiles are never sliced or analysed twice.
+     */
+    class ExportWatcher : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        /**
+         * @param settings exporter whose settings every export copies
+         */
+        ExportWatcher(const QString &mapDir,
+                      const QString &outputDir,
+                      const AS3Level &settings,
+                      QObject *parent = NULL);
+
+        void setMaxJobs(int jobs);
+        void setSettleDelay(int msecs);
+
+        /**
+         * Function makes the watcher keep <output dir>/usage.txt up to date
+         * whenever no exports are running; the exporter settings have to
+         * add their levels to the same report
+         */
+        void setTileUsageReport(TileUsageReport *report);
+
+        void start();
+
+        static const int DEFAULT_SETTLE_DELAY = 500;
+
+    protected slots:
+        void fileChanged(const QString &path);
+        void directoryChanged(const QString &path);
+        void exportSettled();
+        void exportFinished(const QString &mapFile, bool success, const QStringList &dependencies);
+
+    protected:
+        void scanDirectory(const QDir &dir, bool recursive);
+        void queueExport(const QString &mapFile);
+        QString outputFile(const QString &mapFile) const;
+
+        QDir mapDir;
+        QDir outputDir;
+        const AS3Level &settings;
+        TileUsageReport *usageReport;
+
+        QFileSystemWatcher watcher;
+        QHash<QString, QDateTime> knownFiles;      // last seen modification times
+
+        QTimer settleTimer;
+        QSet<QString> changedFiles;
+
+        /**
+         * Files each map depends on, and the maps depending on each file
+         */
+        QHash<QString, QStringList> mapDependencies;
+        QHash<QString, QSet<QString> > dependentMaps;
+
+        QThreadPool pool;
+        QSet<QString> runningExports;
+        QSet<QString> staleExports;                 // changed while running
+    };
+}
+
+#endif // EXPORTWATCHER_H
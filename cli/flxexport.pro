@@ -0,0 +1,10 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+TARGET = flxexport
+include(../flxcore.pri)
+SOURCES += main.cpp \
+    exportwatcher.cpp \
+    ../tmxreader.cpp
+HEADERS += exportwatcher.h \
+    ../tmxreader.h
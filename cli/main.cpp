@@ -0,0 +1,294 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#include <QApplication>
+#include <QStringList>
+#include <QScopedPointer>
+#include <QTextStream>
+#include <QThread>
+#include <QFileInfo>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QHash>
+#include <QtConcurrentMap>
+
+#include "tmxreader.h"
+#include "as3level.h"
+#include "jsonlevelsink.h"
+#include "binarylevelsink.h"
+#include "levelpack.h"
+#include "tileusagereport.h"
+#include "exportwatcher.h"
+
+using namespace Flx;
+
+static int usage(QTextStream &err)
+{
+    err << "Usage: flxexport [options] <map.tmx> <Level.as>\n"
+        << "       flxexport [options] --watch <map dir> <output dir>\n"
+        << "       flxexport [options] --pack <map dir> <output dir>\n"
+        << "  --package <name>          package of the generated class\n"
+        << "  --tilemap-class <class>   tilemap class (default FlxTilemap)\n"
+        << "  --sprite-threshold <pct>  export layers using fewer cells as sprite lists\n"
+        << "  --merge-layers            merge non-overlapping layers into one tilemap\n"
+        << "  --solid-coverage <pct>    opaque pixels from which unmarked tiles are solid\n"
+        << "  --frequency-order         give the most used tiles the smallest IDs\n"
+        << "  --lazy-tilemaps           load tilemaps on first use\n"
+        << "  --large-tile-sprites      export tiles bigger than a cell as sprites\n"
+        << "  --minimaps                export 1/4, 1/8 and 1/16 scale overview images\n"
+        << "  --load-stats              measure tilemap loading in the generated class\n"
+        << "  --usage-report            write unused and near-duplicate tiles to <Level>.usage.txt\n"
+        << "                            (usage.txt over all maps with --watch and --pack)\n"
+        << "  --json                    also write the level as JSON\n"
+        << "  --binary                  also write the level as binary data\n"
+        << "  --watch                   keep re-exporting the maps of a directory tree\n"
+        << "  --pack                    export every map of a directory tree into one\n"
+        << "                            level pack with a LevelPack loader class\n"
+        << "  --jobs <n>                levels exported in parallel in watch mode\n"
+        << "  --settle <ms>             quiet time before changes are exported\n";
+    return 2;
+}
+
+namespace
+{
+    /**
+     * @return the name of a map in a level pack: its path relative to the
+     *         map directory, without suffix (e.g., "world1/intro")
+     */
+    QString packLevelName(const QDir &mapDir, const QString &mapFile)
+    {
+        QFileInfo relative(mapDir.relativeFilePath(mapFile));
+        return QDir::cleanPath(relative.path() + "/" + relative.completeBaseName());
+    }
+
+    /**
+     * Exports one map of a level pack into a directory of its own below
+     * the output directory (named like the level), so that levels never
+     * share graphics files
+     */
+    struct PackExport
+    {
+        typedef bool result_type;
+
+        PackExport(const AS3Level &settings, const QDir &mapDir, const QDir &outputDir)
+            : settings(settings), mapDir(mapDir), outputDir(outputDir) {}
+
+        bool operator()(const QString &mapFile) const
+        {
+            TmxReader reader;
+            QScopedPointer<CompactMap> map(reader.read(mapFile));
+            if (map.isNull())
+            {
+                qWarning() << reader.errorString() << "\n";
+                return false;
+            }
+
+            QDir levelDir(this->outputDir.filePath(packLevelName(this->mapDir, mapFile)));
+            levelDir.mkpath(".");
+            return this->settings.save(levelDir.filePath(QFileInfo(mapFile).completeBaseName() + ".as"),
+                                       map.data());
+        }
+
+        const AS3Level &settings;
+        QDir mapDir;
+        QDir outputDir;
+    };
+}
+
+/**
+ * Function exports every map below mapDir into outputDir/levels.flxpack
+ * and generates outputDir/LevelPack.as to load them; the tile usage of
+ * all maps goes into outputDir/usage.txt if usageReport is set
+ */
+static int exportPack(AS3Level &output, const QString &mapDir, const QString &outputDir,
+                      const QString &packageName, const QString &tilemapClass,
+                      TileUsageReport *usageReport, QTextStream &err)
+{
+    QStringList mapFiles;
+    QDirIterator it(mapDir, QStringList("*.tmx"), QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+        mapFiles.append(it.next());
+
+    // levels are exported concurrently into directories named like them,
+    // so two maps of the same name (e.g., intro.tmx and intro.TMX) would
+    // overwrite each other's files
+    QDir sourceDir(mapDir);
+    QHash<QString, QString> levelMaps;
+    foreach (const QString &mapFile, mapFiles)
+    {
+        QString name = packLevelName(sourceDir, mapFile).toLower();
+        if (levelMaps.contains(name))
+        {
+            err << "Maps " << levelMaps.value(name) << " and " << mapFile
+                << " would be packed under the same name\n";
+            return 1;
+        }
+        levelMaps.insert(name, mapFile);
+    }
+
+    QDir targetDir(outputDir);
+    targetDir.mkpath(".");
+
+    LevelPack pack(targetDir.absolutePath());
+    output.addSink(&pack);
+    output.setClassOutput(false);
+
+    QList<bool> results = QtConcurrent::blockingMapped<QList<bool> >(mapFiles, PackExport(output, sourceDir, targetDir));
+
+    QString packFile = targetDir.filePath("levels.flxpack");
+    bool saved = pack.save(packFile)
+            && pack.saveLoader(targetDir.filePath("LevelPack.as"), packFile, packageName, tilemapClass);
+    if (usageReport)
+        saved = usageReport->write(targetDir.filePath("usage.txt")) && saved;
+
+    int failed = results.count(false);
+    err << pack.count() << " levels packed";
+    if (failed > 0)
+        err << ", " << failed << " maps failed";
+    err << "\n";
+
+    return (saved && failed == 0) ? 0 : 1;
+}
+
+/**
+ * Headless exporter: reads a TMX file and writes the same ActionScript
+ * level (and graphics) the Tiled plugin does
+ */
+int main(int argc, char *argv[])
+{
+    // images are painted, but no window system is needed
+    QApplication app(argc, argv, false);
+    QTextStream err(stderr);
+
+    AS3Level output;
+    output.setTilemapClass("FlxTilemap");
+
+    JsonLevelSink jsonSink;
+    BinaryLevelSink binarySink;
+    TileUsageReport usageReport;
+    bool writeUsageReport = false;
+
+    QString packageName;
+    QString tilemapClass("FlxTilemap");
+
+    bool watch = false;
+    bool packLevels = false;
+    int jobs = QThread::idealThreadCount();
+    int settleDelay = ExportWatcher::DEFAULT_SETTLE_DELAY;
+
+    QStringList files;
+    QStringList args = app.arguments();
+    for (int i = 1; i < args.count(); ++i)
+    {
+        const QString &arg = args.at(i);
+        bool hasValue = i + 1 < args.count();
+
+        if (arg == "--package" && hasValue)
+        {
+            packageName = args.at(++i);
+            output.setPackageName(packageName);
+        }
+        else if (arg == "--tilemap-class" && hasValue)
+        {
+            tilemapClass = args.at(++i);
+            output.setTilemapClass(tilemapClass);
+        }
+        else if (arg == "--sprite-threshold" && hasValue)
+            output.setSpriteListThreshold(args.at(++i).toInt());
+        else if (arg == "--merge-layers")
+            output.setMergeLayers(true);
+        else if (arg == "--solid-coverage" && hasValue)
+            output.setSolidCoverageThreshold(args.at(++i).toInt());
+        else if (arg == "--frequency-order")
+            output.setFrequencyOrder(true);
+        else if (arg == "--lazy-tilemaps")
+            output.setLazyTilemaps(true);
+        else if (arg == "--large-tile-sprites")
+            output.setLargeTileSprites(true);
+        else if (arg == "--minimaps")
+            output.setMinimaps(true);
+        else if (arg == "--load-stats")
+            output.setLoadStats(true);
+        else if (arg == "--usage-report")
+        {
+            output.setTileUsageReport(&usageReport);
+            writeUsageReport = true;
+        }
+        else if (arg == "--json")
+            output.addSink(&jsonSink);
+        else if (arg == "--binary")
+            output.addSink(&binarySink);
+        else if (arg == "--watch")
+            watch = true;
+        else if (arg == "--pack")
+            packLevels = true;
+        else if (arg == "--jobs" && hasValue)
+            jobs = args.at(++i).toInt();
+        else if (arg == "--settle" && hasValue)
+            settleDelay = args.at(++i).toInt();
+        else if (arg.startsWith("--"))
+            return usage(err);
+        else
+            files.append(arg);
+    }
+
+    if (files.count() != 2)
+        return usage(err);
+
+    if (packLevels)
+        return exportPack(output, files.at(0), files.at(1), packageName, tilemapClass,
+                          writeUsageReport ? &usageReport : NULL, err);
+
+    if (watch)
+    {
+        ExportWatcher watcher(files.at(0), files.at(1), output);
+        watcher.setMaxJobs(jobs);
+        watcher.setSettleDelay(settleDelay);
+        if (writeUsageReport)
+            watcher.setTileUsageReport(&usageReport);
+        watcher.start();
+        return app.exec();
+    }
+
+    TmxReader reader;
+    QScopedPointer<CompactMap> map(reader.read(files.at(0)));
+    if (map.isNull())
+    {
+        err << reader.errorString() << "\n";
+        return 1;
+    }
+
+    if (!output.save(files.at(1), map.data()))
+    {
+        err << "Could not write " << files.at(1) << "\n";
+        return 1;
+    }
+
+    if (writeUsageReport)
+    {
+        QFileInfo levelInfo(files.at(1));
+        usageReport.write(levelInfo.dir().filePath(levelInfo.completeBaseName() + ".usage.txt"));
+    }
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "compactmap.h"
+
+using namespace Flx;
+
+CompactTileset::CompactTileset(int firstGid)
+    : mFirstGid(firstGid),
+      mLoaded(false),
+      mTileWidth(0),
+      mTileHeight(0),
+      mTileCount(0)
+{
+}
+
+CompactTileset::~CompactTileset()
+{
+}
+
+void CompactTileset::resolve()
+{
+    if (mLoaded) return;
+
+    mLoaded = true;
+    this->load();
+}
+
+const QString &CompactTileset::name()
+{
+    this->resolve();
+    return mName;
+}
+
+int CompactTileset::tileWidth()
+{
+    this->resolve();
+    return mTileWidth;
+}
+
+int CompactTileset::tileHeight()
+{
+    this->resolve();
+    return mTileHeight;
+}
+
+int CompactTileset::tileCount()
+{
+    this->resolve();
+    return mTileCount;
+}
+
+QMap<QString, QString> CompactTileset::tileProperties(int id)
+{
+    Q_UNUSED(id);
+    return QMap<QString, QString>();
+}
+
+CompactMap::CompactMap()
+    : width(0), height(0), tileWidth(0), tileHeight(0)
+{
+}
+
+CompactMap::~CompactMap()
+{
+    qDeleteAll(this->layers);
+    qDeleteAll(this->tilesets);
+}
+
+void CompactMap::addLayer(CompactLayer *layer)
+{
+    layer->map = this;
+    this->layers.append(layer);
+}
+
+CompactTileset *CompactMap::tilesetForGid(int gid) const
+{
+    // last tileset starting at or before the GID
+    int low = 0, high = this->tilesets.count() - 1;
+    CompactTileset *result = NULL;
+    while (low <= high)
+    {
+        int mid = (low + high) / 2;
+        if (this->tilesets.at(mid)->firstGid() <= gid)
+        {
+            result = this->tilesets.at(mid);
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid - 1;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,143 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef COMPACTMAP_H
+#define COMPACTMAP_H
+
+#include <QString>
+#include <QList>
+#include <QMap>
+#include <QImage>
+
+#include "tilegrid.h"
+
+namespace Flx
+{
+    class CompactMap;
+
+    /**
+     * Tileset of a CompactMap.
+     *
+     * Everything except the first GID is resolved lazily, so that
+     * tilesets (and their images) that a map references but no exported
+     * layer uses are never loaded.
+     *
+     * Not thread-safe; resolve the tilesets a worker needs beforehand.
+     */
+    class CompactTileset
+    {
+    public:
+        explicit CompactTileset(int firstGid);
+        virtual ~CompactTileset();
+
+        int firstGid() const { return mFirstGid; }
+
+        const QString &name();
+        int tileWidth();
+        int tileHeight();
+        int tileCount();
+
+        /**
+         * @return image of the tile with the given local id
+         */
+        virtual QImage tileImage(int id) = 0;
+
+        /**
+         * @return key identifying the tile's current image; it changes with
+         *         the image but stays the same for a new tileset object
+         *         loaded from the same source (used as cache key)
+         */
+        virtual qint64 tileImageKey(int id) = 0;
+
+        /**
+         * @return custom properties of the tile with the given local id
+         */
+        virtual QMap<QString, QString> tileProperties(int id);
+
+    protected:
+        /**
+         * Function fills in name, tile size and tile count
+         */
+        virtual void load() = 0;
+
+        void resolve();
+
+        int mFirstGid;
+        bool mLoaded;
+
+        QString mName;
+        int mTileWidth;
+        int mTileHeight;
+        int mTileCount;
+    };
+
+    /**
+     * Tile layer stored as a dense grid of global tile IDs (0 = empty)
+     */
+    struct CompactLayer
+    {
+        CompactLayer() : map(0), visible(true), opacity(1.0) {}
+
+        const CompactMap *map;
+
+        QString name;
+        bool visible;
+        qreal opacity;
+        QMap<QString, QString> properties;
+
+        TileGrid gids;
+    };
+
+    /**
+     * Map representation the export works on: layers are plain GID arrays,
+     * no per-cell objects are ever created.
+     *
+     * Owns its tilesets and layers.
+     */
+    class CompactMap
+    {
+    public:
+        CompactMap();
+        ~CompactMap();
+
+        int width;
+        int height;
+        int tileWidth;
+        int tileHeight;
+
+        QMap<QString, QString> properties;
+
+        QList<CompactTileset *> tilesets;   // ordered by first GID
+        QList<CompactLayer *> layers;       // tile layers, bottom to top
+
+        void addLayer(CompactLayer *layer);
+
+        /**
+         * @return tileset containing the given GID, or NULL
+         */
+        CompactTileset *tilesetForGid(int gid) const;
+
+    private:
+        Q_DISABLE_COPY(CompactMap)
+    };
+}
+
+#endif // COMPACTMAP_H
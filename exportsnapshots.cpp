@@ -0,0 +1,99 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#include <QFileInfo>
+#include <QMutexLocker>
+
+#include "exportsnapshots.h"
+
+using namespace Flx;
+
+ExportSnapshots *ExportSnapshots::instance()
+{
+    static ExportSnapshots snapshots;
+    return &snapshots;
+}
+
+ExportSnapshots::ExportSnapshots()
+{
+    this->setMemoryBudget(DEFAULT_MEMORY_BUDGET);
+}
+
+QString ExportSnapshots::key(const QString &levelFileName, const QString &layerName)
+{
+    return QFileInfo(levelFileName).absoluteFilePath() + "\n" + layerName;
+}
+
+/**
+ * Baked chunks are the expensive part to regenerate, so they get half of
+ * the budget although tile data snapshots are more numerous.
+ */
+void ExportSnapshots::setMemoryBudget(int bytes)
+{
+    QMutexLocker locker(&this->mutex);
+    this->bakes.setMaxCost(bytes / 2);
+    this->tileData.setMaxCost(bytes - bytes / 2);
+}
+
+bool ExportSnapshots::findBake(const QString &key, BakeSnapshot &snapshot)
+{
+    QMutexLocker locker(&this->mutex);
+
+    BakeSnapshot *cached = this->bakes.object(key);
+    if (cached == NULL)
+        return false;
+
+    snapshot = *cached;
+    return true;
+}
+
+void ExportSnapshots::insertBake(const QString &key, const BakeSnapshot &snapshot)
+{
+    int cost = snapshot.gids.width() * snapshot.gids.height() * sizeof(int);
+    foreach (const BakedChunk &chunk, snapshot.chunks)
+        cost += chunk.png.size();
+
+    QMutexLocker locker(&this->mutex);
+    this->bakes.insert(key, new BakeSnapshot(snapshot), cost);
+}
+
+bool ExportSnapshots::findTileData(const QString &key, TileDataSnapshot &snapshot)
+{
+    QMutexLocker locker(&this->mutex);
+
+    TileDataSnapshot *cached = this->tileData.object(key);
+    if (cached == NULL)
+        return false;
+
+    snapshot = *cached;
+    return true;
+}
+
+void ExportSnapshots::insertTileData(const QString &key, const TileDataSnapshot &snapshot)
+{
+    int cost = snapshot.grid.width() * snapshot.grid.height() * sizeof(int);
+    foreach (const QString &row, snapshot.rows)
+        cost += row.size() * sizeof(QChar);
+
+    QMutexLocker locker(&this->mutex);
+    this->tileData.insert(key, new TileDataSnapshot(snapshot), cost);
+}
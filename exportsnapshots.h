@@ -0,0 +1,100 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef EXPORTSNAPSHOTS_H
+#define EXPORTSNAPSHOTS_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QCache>
+#include <QByteArray>
+#include <QMutex>
+
+#include "tilegrid.h"
+#include "backgroundbaker.h"
+
+namespace Flx
+{
+    /**
+     * What the previous export of a baked layer produced
+     */
+    struct BakeSnapshot
+    {
+        TileGrid gids;
+        QByteArray signature;       // see BackgroundBaker::signature
+        QList<BakedChunk> chunks;
+    };
+
+    /**
+     * What the previous export of a tilemap layer produced: its tile
+     * grid and the formatted tile data, one string per row
+     */
+    struct TileDataSnapshot
+    {
+        TileGrid grid;
+        QStringList rows;
+    };
+
+    /**
+     * Class keeps the output of the previous export of every layer, so
+     * that the next export only regenerates the parts of a layer whose
+     * cells changed and splices in the rest.
+     *
+     * Changes are found by comparing the new cells with the previous ones,
+     * which is a plain memory comparison and far cheaper than rendering
+     * and formatting the layer again.
+     *
+     * Entries are keyed by level file and layer and share a memory budget;
+     * the least recently used ones are evicted first. Thread-safe.
+     */
+    class ExportSnapshots
+    {
+    public:
+        static ExportSnapshots *instance();
+
+        static QString key(const QString &levelFileName, const QString &layerName);
+
+        bool findBake(const QString &key, BakeSnapshot &snapshot);
+        void insertBake(const QString &key, const BakeSnapshot &snapshot);
+
+        bool findTileData(const QString &key, TileDataSnapshot &snapshot);
+        void insertTileData(const QString &key, const TileDataSnapshot &snapshot);
+
+        /**
+         * Function sets the memory used for snapshots, in bytes
+         */
+        void setMemoryBudget(int bytes);
+
+        static const int DEFAULT_MEMORY_BUDGET = 64 * 1024 * 1024;
+
+    protected:
+        ExportSnapshots();
+
+        QCache<QString, BakeSnapshot> bakes;
+        QCache<QString, TileDataSnapshot> tileData;
+
+        QMutex mutex;
+    };
+}
+
+#endif // EXPORTSNAPSHOTS_H
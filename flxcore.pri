@@ -0,0 +1,46 @@
+# Export core shared by the Tiled plugin and the command line exporter
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+SOURCES += $$PWD/as3level.cpp \
+    $$PWD/atomicfile.cpp \
+    $$PWD/tilegrid.cpp \
+    $$PWD/backgroundbaker.cpp \
+    $$PWD/tilecache.cpp \
+    $$PWD/compactmap.cpp \
+    $$PWD/tileoutline.cpp \
+    $$PWD/navgrid.cpp \
+    $$PWD/stringtable.cpp \
+    $$PWD/pngwriter.cpp \
+    $$PWD/pngreader.cpp \
+    $$PWD/minimaprenderer.cpp \
+    $$PWD/tileusagereport.cpp \
+    $$PWD/exportsnapshots.cpp \
+    $$PWD/jsonlevelsink.cpp \
+    $$PWD/binarylevelsink.cpp \
+    $$PWD/levelpack.cpp
+HEADERS += $$PWD/as3level.h \
+    $$PWD/as3levelplaceholders.h \
+    $$PWD/atomicfile.h \
+    $$PWD/tilegrid.h \
+    $$PWD/layerproperties.h \
+    $$PWD/backgroundbaker.h \
+    $$PWD/tilecache.h \
+    $$PWD/compactmap.h \
+    $$PWD/tileoutline.h \
+    $$PWD/navgrid.h \
+    $$PWD/stringtable.h \
+    $$PWD/pngwriter.h \
+    $$PWD/pngreader.h \
+    $$PWD/minimaprenderer.h \
+    $$PWD/tileusagereport.h \
+    $$PWD/exportsnapshots.h \
+    $$PWD/levelsink.h \
+    $$PWD/jsonlevelsink.h \
+    $$PWD/binarylevelsink.h \
+    $$PWD/levelpack.h \
+    $$PWD/progresslistener.h
+RESOURCES += $$PWD/ASTemplates.qrc
+
+# zlib (for PNG and TMX layer data streams) ships with Qt on Windows
+win32:INCLUDEPATH += $$[QT_INSTALL_PREFIX]/src/3rdparty/zlib
+else:LIBS += -lz
@@ -30,7 +30,11 @@
 #include "tile.h"
 
 #include "settingsdialog.h"
+#include "progressdialog.h"
+#include "tiledmapconverter.h"
 #include "as3level.h"
+#include "jsonlevelsink.h"
+#include "binarylevelsink.h"
 
 #include <QStringList>
 #include <QQueue>
@@ -48,6 +52,7 @@
 #include <QRegExp>
 #include <QTextStream>
 #include <QMessageBox>
+#include <QScopedPointer>
 
 using namespace Flx;
 
@@ -167,6 +172,7 @@ bool FlxExporter::write(const Tiled::Map *map, const QString &fileName)
         //}
     }
 
+    sd.setMap(map);
     sd.generateSummary(map);
     if (sd.exec() == QDialog::Rejected)
     {
@@ -178,10 +184,37 @@ bool FlxExporter::write(const Tiled::Map *map, const QString &fileName)
     output.setPackageName(sd.getPackageName());
     qDebug() << "tilemap class: " << sd.getTilemapClass() << "\n";
     output.setTilemapClass(sd.getTilemapClass());
-
-
-    if (output.save(fileName, map))
+    output.setSpriteListThreshold(sd.getSpriteListThreshold());
+    output.setMergeLayers(sd.mergeLayers());
+    output.setSolidCoverageThreshold(sd.getSolidCoverageThreshold());
+    output.setFrequencyOrder(sd.frequencyOrder());
+    output.setLazyTilemaps(sd.lazyTilemaps());
+    output.setLargeTileSprites(sd.largeTileSprites());
+    output.setMinimaps(sd.minimaps());
+    output.setLoadStats(sd.loadStats());
+
+    // the plugin exports one map at a time, so its report only covers
+    // the level being saved
+    TileUsageReport usageReport;
+    if (sd.tileUsageReport())
+        output.setTileUsageReport(&usageReport);
+
+    JsonLevelSink jsonSink;
+    if (sd.jsonOutput())
+        output.addSink(&jsonSink);
+    BinaryLevelSink binarySink;
+    if (sd.binaryOutput())
+        output.addSink(&binarySink);
+
+    ProgressDialog pd(NULL);
+    output.setProgressListener(&pd);
+
+    QScopedPointer<CompactMap> compactMap(TiledMapConverter::convert(map));
+    if (output.save(fileName, compactMap.data()))
     {
+        if (sd.tileUsageReport())
+            usageReport.write(targetDir.filePath(targetFileInfo.completeBaseName() + ".usage.txt"));
+
         QString derivedFileName = sd.getDerivedFileName();
         if (!derivedFileName.isEmpty())
         {
@@ -0,0 +1,148 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#include <QFileInfo>
+#include <QDir>
+#include <QTextStream>
+#include <QDebug>
+
+#include "atomicfile.h"
+#include "jsonlevelsink.h"
+
+using namespace Flx;
+
+QString JsonLevelSink::quote(const QString &string)
+{
+    QString result("\"");
+    for (int i = 0; i < string.size(); ++i)
+    {
+        QChar c = string.at(i);
+        if (c == '"' || c == '\\')
+            result += QString("\\") + c;
+        else if (c.unicode() < 0x20)
+            result += QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0'));
+        else
+            result += c;
+    }
+    return result + "\"";
+}
+
+bool JsonLevelSink::write(const QString &levelFileName,
+                          const CompactMap *map,
+                          const QList<ExportedLayer> &layers)
+{
+    static const char *kindNames[] = { "tilemap", "sprites", "baked" };
+
+    QFileInfo levelInfo(levelFileName);
+
+    QString json;
+    QTextStream stream(&json);
+    stream << "{\n"
+           << "  \"level\": " << quote(levelInfo.baseName()) << ",\n"
+           << "  \"width\": " << map->width << ",\n"
+           << "  \"height\": " << map->height << ",\n"
+           << "  \"tileWidth\": " << map->tileWidth << ",\n"
+           << "  \"tileHeight\": " << map->tileHeight << ",\n"
+           << "  \"layers\": [";
+
+    for (int l = 0; l < layers.count(); ++l)
+    {
+        const ExportedLayer &layer = layers.at(l);
+
+        stream << (l == 0 ? "\n" : ",\n")
+               << "    {\n"
+               << "      \"name\": " << quote(layer.name) << ",\n"
+               << "      \"kind\": \"" << kindNames[layer.kind] << "\",\n"
+               << "      \"layers\": [";
+        for (int i = 0; i < layer.layerNames.count(); ++i)
+            stream << (i == 0 ? "" : ", ") << quote(layer.layerNames.at(i));
+        stream << "],\n"
+               << "      \"properties\": {";
+        bool first = true;
+        for (QMap<QString, QString>::const_iterator it = layer.properties.constBegin();
+             it != layer.properties.constEnd(); ++it, first = false)
+        {
+            stream << (first ? "" : ", ") << quote(it.key()) << ": " << quote(it.value());
+        }
+        stream << "},\n"
+               << "      \"x\": " << layer.bounds.x() << ", \"y\": " << layer.bounds.y()
+               << ", \"width\": " << layer.bounds.width() << ", \"height\": " << layer.bounds.height();
+
+        if (layer.kind == ExportedLayer::BAKED)
+        {
+            stream << ",\n      \"images\": [";
+            for (int i = 0; i < layer.images.count(); ++i)
+            {
+                const ExportedImage &image = layer.images.at(i);
+                stream << (i == 0 ? "\n" : ",\n")
+                       << "        { \"file\": " << quote(image.file)
+                       << ", \"x\": " << image.rect.x() << ", \"y\": " << image.rect.y()
+                       << ", \"width\": " << image.rect.width()
+                       << ", \"height\": " << image.rect.height() << " }";
+            }
+            stream << "\n      ]\n";
+        }
+        else
+        {
+            stream << ",\n"
+                   << "      \"collideIndex\": " << layer.collideIndex << ",\n"
+                   << "      \"tileCount\": " << layer.tileCount << ",\n"
+                   << "      \"tilesheet\": " << quote(layer.tilesheetFile) << ",\n";
+            if (!layer.largeTileFile.isEmpty())
+            {
+                // (column, row, frame) triples, like the class's placement lists
+                stream << "      \"largeTiles\": { \"atlas\": " << quote(layer.largeTileFile)
+                       << ", \"frameWidth\": " << layer.largeTileFrame.width()
+                       << ", \"frameHeight\": " << layer.largeTileFrame.height()
+                       << ", \"placements\": [";
+                for (int i = 0; i < layer.largeTiles.count(); ++i)
+                {
+                    const ExportedLargeTile &sprite = layer.largeTiles.at(i);
+                    stream << (i == 0 ? "" : ",")
+                           << sprite.cell.x() << "," << sprite.cell.y() << "," << sprite.frame;
+                }
+                stream << "] },\n";
+            }
+            stream << "      \"tiles\": [";
+            for (int j = 0; j < layer.tiles.height(); ++j)
+            {
+                const int *row = layer.tiles.constRow(j);
+                stream << (j == 0 ? "\n        [" : ",\n        [");
+                for (int i = 0; i < layer.tiles.width(); ++i)
+                    stream << (i == 0 ? "" : ",") << row[i];
+                stream << "]";
+            }
+            stream << "\n      ]\n";
+        }
+        stream << "    }";
+    }
+    stream << "\n  ]\n}\n";
+    stream.flush();
+
+    QString jsonFile = levelInfo.dir().filePath(levelInfo.completeBaseName() + ".json");
+    if (!AtomicFile::writeIfChanged(jsonFile, json.toUtf8()))
+    {
+        qWarning() << "Could not save " << jsonFile << "\n";
+        return false;
+    }
+    return true;
+}
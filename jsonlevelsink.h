@@ -0,0 +1,47 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef JSONLEVELSINK_H
+#define JSONLEVELSINK_H
+
+#include "levelsink.h"
+
+namespace Flx
+{
+    /**
+     * Writes <level>.json, a description of the level for tools: map and
+     * tile size, and per layer its kind, placement, collideIndex, graphics
+     * and tile rows
+     */
+    class JsonLevelSink : public LevelSink
+    {
+    public:
+        bool write(const QString &levelFileName,
+                   const CompactMap *map,
+                   const QList<ExportedLayer> &layers);
+
+    protected:
+        static QString quote(const QString &string);
+    };
+}
+
+#endif // JSONLEVELSINK_H
@@ -0,0 +1,32 @@
+#ifndef LAYERPROPERTIES_H
+#define LAYERPROPERTIES_H
+
+/**
+ * Custom layer properties (set in Tiled's layer properties dialog)
+ * that change how a layer is exported
+ */
+namespace FlxLayerProperties
+{
+    // layer is used for collision, so it always keeps its own tilemap
+    const char* const COLLISION = "collision";
+
+    // layer is pre-rendered into flat images; an optional value sets
+    // the chunk size in pixels
+    const char* const STATIC_BACKGROUND = "static";
+
+    // layer is needed right away (e.g., visible at the spawn point), so
+    // with lazy tilemaps it still loads when the level is created
+    const char* const PRELOAD = "preload";
+}
+
+/**
+ * Custom tile properties (set in Tiled's tile properties dialog)
+ */
+namespace FlxTileProperties
+{
+    // tile is solid ("false" or "0" = not solid), overriding the
+    // opaque pixel threshold
+    const char* const SOLID = "solid";
+}
+
+#endif // LAYERPROPERTIES_H
@@ -0,0 +1,191 @@
+package %packageName%
+{
+	import flash.utils.ByteArray;
+	import org.flixel.FlxGroup;
+	import org.flixel.FlxSprite;
+	import org.flixel.FlxTilemap;
+	
+	/**
+	 * Level pack of %levelCount% levels
+	 * Generated By: %generatedBy%
+	 *
+	 * Tilemap Class: %tilemapClass%
+	 *
+	 * Levels are decoded one at a time from the embedded pack; the index
+	 * at its start points straight at each level's data.
+	 */
+	public class %className%
+	{
+		[Embed(source="%packFile%", mimeType="application/octet-stream")]
+		protected static const PackData: Class;
+		
+		//{ region Constant graphical asset declarations
+		%gfxEmbedStatements%
+		//} endregion
+		
+		protected static var pack: ByteArray;
+		protected static var index: Object;
+		protected static var graphics: Object;
+		
+		/**
+		 * @return names of the levels in the pack
+		 */
+		public static function get levelNames(): Array
+		{
+			readIndex();
+			var names: Array = [];
+			for (var name: String in index)
+				names.push(name);
+			return names.sort();
+		}
+		
+		/**
+		 * @return the level's layers, bottom to top, or null if the pack has no such level
+		 */
+		public static function loadLevel(name: String): FlxGroup
+		{
+			readIndex();
+			if (!(name in index)) return null;
+			
+			pack.position = index[name];
+			if (pack.readUTFBytes(4) != "FLXL" || pack.readUnsignedShort() != %levelVersion%) return null;
+			
+			pack.readUnsignedInt();
+			pack.readUnsignedInt();
+			var tileWidth: uint = pack.readUnsignedInt();
+			var tileHeight: uint = pack.readUnsignedInt();
+			
+			var level: FlxGroup = new FlxGroup();
+			var layerCount: uint = pack.readUnsignedInt();
+			for (var l: uint = 0; l < layerCount; ++l)
+			{
+				var kind: uint = pack.readUnsignedByte();
+				readString();
+				var x: int = pack.readInt();
+				var y: int = pack.readInt();
+				var width: uint = pack.readUnsignedInt();
+				var height: uint = pack.readUnsignedInt();
+				var collideIndex: uint = pack.readUnsignedInt();
+				var tileCount: uint = pack.readUnsignedInt();
+				var tilesheet: String = readString();
+				
+				var imageCount: uint = pack.readUnsignedInt();
+				for (var i: uint = 0; i < imageCount; ++i)
+				{
+					var imageX: int = pack.readInt();
+					var imageY: int = pack.readInt();
+					var image: FlxSprite = new FlxSprite(imageX, imageY, graphics[name + "/" + readString()]);
+					image.active = false;
+					level.add(image);
+				}
+				
+				var largeTileAtlas: String = readString();
+				var frameWidth: uint = pack.readUnsignedInt();
+				var frameHeight: uint = pack.readUnsignedInt();
+				var largeTiles: Array = readTiles(pack.readUnsignedInt() * 3, true);
+				
+				if (kind == 2) continue;
+				
+				var tiles: Array = readTiles(width * height, tileCount > 0xFFFF);
+				var graphic: Class = graphics[name + "/" + tilesheet];
+				if (kind == 1)
+					level.add(createSprites(tiles, width, graphic, tileWidth, tileHeight));
+				else
+					level.add(createTilemap(tiles, x, y, width, collideIndex, graphic, tileWidth, tileHeight));
+				
+				if (largeTiles.length > 0)
+					level.add(createLargeTiles(largeTiles, graphics[name + "/" + largeTileAtlas],
+						tileWidth, tileHeight, frameWidth, frameHeight));
+			}
+			return level;
+		}
+		
+		protected static function readIndex(): void
+		{
+			if (pack) return;
+			
+			pack = new PackData() as ByteArray;
+			index = {};
+			if (pack.readUTFBytes(4) != "FLXP" || pack.readUnsignedShort() != %packVersion%) return;
+			
+			var levelCount: uint = pack.readUnsignedInt();
+			for (var i: uint = 0; i < levelCount; ++i)
+			{
+				var name: String = readString();
+				index[name] = pack.readUnsignedInt();
+				pack.readUnsignedInt();
+			}
+			
+			graphics = {
+				%graphicsTable%
+			};
+		}
+		
+		protected static function readString(): String
+		{
+			return pack.readUTFBytes(pack.readUnsignedShort());
+		}
+		
+		protected static function readTiles(count: uint, wide: Boolean): Array
+		{
+			var tiles: Array = new Array(count);
+			for (var i: uint = 0; i < count; ++i)
+				tiles[i] = wide ? pack.readUnsignedInt() : pack.readUnsignedShort();
+			return tiles;
+		}
+		
+		protected static function createTilemap(Tiles: Array, X: int, Y: int, Width: uint, CollideIndex: uint,
+			Graphic: Class, TileWidth: uint, TileHeight: uint): %tilemapClass%
+		{
+			var rows: Array = [];
+			for (var i: uint = 0; i < Tiles.length; i += Width)
+				rows.push(Tiles.slice(i, i + Width).join(","));
+			
+			var tilemap: %tilemapClass% = new %tilemapClass%();
+			tilemap.collideIndex = CollideIndex;
+			tilemap.loadMap(rows.join("\n"), Graphic);
+			tilemap.x = X * TileWidth;
+			tilemap.y = Y * TileHeight;
+			return tilemap;
+		}
+		
+		protected static function createSprites(Tiles: Array, Width: uint, Graphic: Class,
+			TileWidth: uint, TileHeight: uint): FlxGroup
+		{
+			var group: FlxGroup = new FlxGroup();
+			for (var i: uint = 0; i < Tiles.length; ++i)
+			{
+				if (Tiles[i] == 0) continue;
+				
+				var sprite: FlxSprite = new FlxSprite((i % Width) * TileWidth, uint(i / Width) * TileHeight);
+				sprite.loadGraphic(Graphic, true, false, TileWidth, TileHeight);
+				sprite.frame = Tiles[i];
+				sprite.active = false;
+				sprite.solid = false;
+				group.add(sprite);
+			}
+			return group;
+		}
+		
+		/**
+		 * Large tiles are anchored at the bottom-left of their cell, like in Tiled
+		 */
+		protected static function createLargeTiles(Placements: Array, Graphic: Class, TileWidth: uint, TileHeight: uint,
+			FrameWidth: uint, FrameHeight: uint): FlxGroup
+		{
+			var group: FlxGroup = new FlxGroup();
+			for (var i: uint = 0; i < Placements.length; i += 3)
+			{
+				var sprite: FlxSprite = new FlxSprite(Placements[i] * TileWidth,
+					(Placements[i + 1] + 1) * TileHeight - FrameHeight);
+				sprite.loadGraphic(Graphic, true, false, FrameWidth, FrameHeight);
+				sprite.frame = Placements[i + 2];
+				sprite.active = false;
+				sprite.solid = false;
+				group.add(sprite);
+			}
+			return group;
+		}
+	}
+
+}
@@ -0,0 +1,169 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDataStream>
+#include <QTextStream>
+#include <QMutexLocker>
+#include <QDebug>
+
+#include "atomicfile.h"
+#include "binarylevelsink.h"
+#include "as3levelplaceholders.h"
+#include "levelpack.h"
+
+using namespace Flx;
+
+LevelPack::LevelPack(const QString &rootDir)
+    : rootDir(rootDir)
+{
+}
+
+bool LevelPack::write(const QString &levelFileName,
+                      const CompactMap *map,
+                      const QList<ExportedLayer> &layers)
+{
+    QFileInfo levelInfo(levelFileName);
+
+    Level level;
+    level.data = BinaryLevelSink::encode(map, layers);
+    level.directory = levelInfo.absolutePath();
+    foreach (const ExportedLayer &layer, layers)
+    {
+        if (!layer.tilesheetFile.isEmpty() && !level.graphics.contains(layer.tilesheetFile))
+            level.graphics.append(layer.tilesheetFile);
+        foreach (const ExportedImage &image, layer.images)
+            level.graphics.append(image.file);
+        if (!layer.largeTileFile.isEmpty())
+            level.graphics.append(layer.largeTileFile);
+    }
+
+    QString name = this->rootDir.relativeFilePath(level.directory);
+
+    QMutexLocker locker(&this->mutex);
+    if (this->levels.contains(name))
+        qWarning() << "Level " << name << " is exported twice, keeping the last\n";
+    this->levels.insert(name, level);
+    return true;
+}
+
+int LevelPack::count() const
+{
+    QMutexLocker locker(&this->mutex);
+    return this->levels.count();
+}
+
+bool LevelPack::save(const QString &packFileName) const
+{
+    QMutexLocker locker(&this->mutex);
+
+    QByteArray index;
+    QDataStream indexStream(&index, QIODevice::WriteOnly);
+    indexStream.setByteOrder(QDataStream::BigEndian);
+
+    // offsets count from the start of the pack, so the header size has
+    // to be known first
+    quint32 headerSize = 4 + 2 + 4;
+    for (QMap<QString, Level>::const_iterator it = this->levels.constBegin(); it != this->levels.constEnd(); ++it)
+        headerSize += 2 + it.key().toUtf8().size() + 4 + 4;
+
+    QByteArray pack;
+    QDataStream stream(&pack, QIODevice::WriteOnly);
+    stream.setByteOrder(QDataStream::BigEndian);
+    stream.writeRawData("FLXP", 4);
+    stream << VERSION << quint32(this->levels.count());
+
+    quint32 offset = headerSize;
+    for (QMap<QString, Level>::const_iterator it = this->levels.constBegin(); it != this->levels.constEnd(); ++it)
+    {
+        QByteArray name = it.key().toUtf8();
+        stream << quint16(name.size());
+        stream.writeRawData(name.constData(), name.size());
+        stream << offset << quint32(it.value().data.size());
+        offset += it.value().data.size();
+    }
+
+    for (QMap<QString, Level>::const_iterator it = this->levels.constBegin(); it != this->levels.constEnd(); ++it)
+        stream.writeRawData(it.value().data.constData(), it.value().data.size());
+
+    if (!AtomicFile::writeIfChanged(packFileName, pack))
+    {
+        qWarning() << "Could not save level pack " << packFileName << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool LevelPack::saveLoader(const QString &fileName,
+                           const QString &packFileName,
+                           const QString &packageName,
+                           const QString &tilemapClass) const
+{
+    QFile tmp(":/levelPackTemplate.as");
+    if (!tmp.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+    QString buffer(tmp.readAll());
+
+    QFileInfo loaderInfo(fileName);
+    QDir loaderDir(loaderInfo.absolutePath());
+
+    QMutexLocker locker(&this->mutex);
+
+    // graphics are looked up as "<level>/<file relative to the level>"
+    QString embedStatements, graphicsTable;
+    int graphicCount = 0;
+    for (QMap<QString, Level>::const_iterator it = this->levels.constBegin(); it != this->levels.constEnd(); ++it)
+    {
+        QDir levelDir(it.value().directory);
+        foreach (const QString &graphic, it.value().graphics)
+        {
+            QString constName = QString("Gfx%1").arg(graphicCount++);
+            QTextStream(&embedStatements)
+                    << QString("[Embed(source=\"%1\")]\n\t\t")
+                       .arg(loaderDir.relativeFilePath(levelDir.filePath(graphic)))
+                    << "protected static const " << constName << ": Class;\n\t\t";
+            QTextStream(&graphicsTable)
+                    << (graphicCount == 1 ? "" : ",\n\t\t\t\t")
+                    << QString("\"%1/%2\": %3").arg(it.key(), graphic, constName);
+        }
+    }
+
+    buffer.replace(FlxPlaceholders::PACKAGE_NAME, packageName);
+    buffer.replace(FlxPlaceholders::CLASS_NAME, loaderInfo.baseName());
+    buffer.replace(FlxPlaceholders::TILEMAP_CLASS, tilemapClass);
+    buffer.replace(FlxPlaceholders::GEN_BY, "FlxExporter v0.2");
+    buffer.replace(FlxPlaceholders::LEVEL_COUNT, QString::number(this->levels.count()));
+    buffer.replace(FlxPlaceholders::PACK_FILE, loaderDir.relativeFilePath(packFileName));
+    buffer.replace(FlxPlaceholders::PACK_VERSION, QString::number(VERSION));
+    buffer.replace(FlxPlaceholders::LEVEL_VERSION, QString::number(BinaryLevelSink::VERSION));
+    buffer.replace(FlxPlaceholders::GFX_EMBED_STATEMENTS, embedStatements);
+    buffer.replace(FlxPlaceholders::GRAPHICS_TABLE, graphicsTable);
+
+    if (!AtomicFile::writeIfChanged(fileName, buffer.toUtf8()))
+    {
+        qWarning() << "Could not save level pack loader " << fileName << "\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,100 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef LEVELPACK_H
+#define LEVELPACK_H
+
+#include <QString>
+#include <QStringList>
+#include <QMap>
+#include <QDir>
+#include <QByteArray>
+#include <QMutex>
+
+#include "levelsink.h"
+
+namespace Flx
+{
+    /**
+     * Collects many levels into one pack file plus a generated loader
+     * class, in place of one class per level.
+     *
+     * The pack is big-endian (readable with ActionScript's ByteArray):
+     *
+     *   "FLXP", uint16 version (1)
+     *   uint32 level count, then per level (ordered by name):
+     *     uint16 name length, UTF-8 name
+     *     uint32 offset of the level data from the start of the pack
+     *     uint32 length of the level data
+     *   the level data, each in BinaryLevelSink's format
+     *
+     * Unlike other sinks, a pack keeps every level written to it; levels
+     * may be written from several threads at once.
+     */
+    class LevelPack : public LevelSink
+    {
+    public:
+        /**
+         * @param rootDir directory below which every level is exported
+         *        into a directory of its own
+         */
+        explicit LevelPack(const QString &rootDir);
+
+        /**
+         * Function adds a level to the pack, named after its directory
+         * relative to the root directory (a level of the same name is
+         * replaced)
+         */
+        bool write(const QString &levelFileName,
+                   const CompactMap *map,
+                   const QList<ExportedLayer> &layers);
+
+        int count() const;
+
+        bool save(const QString &packFileName) const;
+
+        /**
+         * Function generates the loader class, which embeds the pack and
+         * every graphic its levels use; the class is named after the file
+         */
+        bool saveLoader(const QString &fileName,
+                        const QString &packFileName,
+                        const QString &packageName,
+                        const QString &tilemapClass) const;
+
+        static const quint16 VERSION = 1;
+
+    protected:
+        struct Level
+        {
+            QByteArray data;
+            QString directory;          // of the level file
+            QStringList graphics;       // relative to the level file
+        };
+
+        QDir rootDir;
+        QMap<QString, Level> levels;   // by name
+        mutable QMutex mutex;
+    };
+}
+
+#endif // LEVELPACK_H
@@ -0,0 +1,107 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef LEVELSINK_H
+#define LEVELSINK_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QRect>
+#include <QPoint>
+#include <QSize>
+#include <QMap>
+
+#include "compactmap.h"
+#include "tilegrid.h"
+
+namespace Flx
+{
+    /**
+     * Image written for a baked layer, placed at rect (in pixels)
+     */
+    struct ExportedImage
+    {
+        QRect rect;
+        QString file;       // relative to the level file
+    };
+
+    /**
+     * Large tile sprite: a frame of its layer's atlas drawn at a cell,
+     * anchored at the cell's bottom-left
+     */
+    struct ExportedLargeTile
+    {
+        QPoint cell;
+        int frame;
+    };
+
+    /**
+     * Result of exporting one layer group, as seen by every output format
+     */
+    struct ExportedLayer
+    {
+        enum Kind { TILEMAP, SPRITE_LIST, BAKED };
+
+        ExportedLayer() : kind(TILEMAP), collideIndex(1), tileCount(0), largeTileFrame(0, 0) {}
+
+        Kind kind;
+        QString name;               // of the first layer of the group
+        QString varName;
+        QStringList layerNames;     // every layer of the group
+        QMap<QString, QString> properties;
+
+        QRect bounds;               // cells covered by tiles (whole map for sprite lists)
+        TileGrid tiles;             // flixel tile indices within bounds
+        int collideIndex;
+        int tileCount;              // tile indices used, including 0
+        QString tilesheetFile;      // relative to the level file
+
+        QList<ExportedImage> images;     // baked layers only
+
+        QString largeTileFile;          // atlas, relative to the level file; empty if none
+        QSize largeTileFrame;           // in pixels
+        QList<ExportedLargeTile> largeTiles;    // in drawing order
+    };
+
+    /**
+     * Output format fed from the same traversal as the ActionScript class,
+     * sharing its tile ID maps and tilesheets.
+     *
+     * Sinks may be used by several exports at once (see the watch mode),
+     * so write must be thread-safe; most keep no state between calls.
+     */
+    class LevelSink
+    {
+    public:
+        virtual ~LevelSink() {}
+
+        /**
+         * Function writes the format's file(s) next to the level file
+         */
+        virtual bool write(const QString &levelFileName,
+                           const CompactMap *map,
+                           const QList<ExportedLayer> &layers) = 0;
+    };
+}
+
+#endif // LEVELSINK_H
@@ -0,0 +1,139 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#include <QBuffer>
+#include <QDebug>
+
+#include "pngwriter.h"
+#include "minimaprenderer.h"
+
+using namespace Flx;
+
+MinimapRenderer::MinimapRenderer(const CompactMap *map)
+    : map(map)
+{
+    foreach (const CompactLayer *layer, map->layers)
+    {
+        if (layer->visible)
+            this->layerRenderers.append(new BackgroundBaker(layer, BackgroundBaker::DEFAULT_CHUNK_SIZE));
+    }
+}
+
+MinimapRenderer::~MinimapRenderer()
+{
+    qDeleteAll(this->layerRenderers);
+}
+
+QList<QByteArray> MinimapRenderer::render() const
+{
+    const int smallest = scale(LEVEL_COUNT - 1);
+    const int pixelWidth = this->map->width * this->map->tileWidth;
+    const int pixelHeight = this->map->height * this->map->tileHeight;
+
+    // strips are padded (with transparent pixels) to whole output pixels
+    // of every level
+    const int paddedWidth = (pixelWidth + smallest - 1) / smallest * smallest;
+
+    QByteArray data[LEVEL_COUNT];
+    QBuffer buffers[LEVEL_COUNT];
+    PngWriter *writers[LEVEL_COUNT];
+    QImage levels[LEVEL_COUNT];
+    for (int i = 0; i < LEVEL_COUNT; ++i)
+    {
+        buffers[i].setBuffer(&data[i]);
+        buffers[i].open(QIODevice::WriteOnly);
+        writers[i] = new PngWriter(&buffers[i],
+                                   (pixelWidth + scale(i) - 1) / scale(i),
+                                   (pixelHeight + scale(i) - 1) / scale(i));
+        levels[i] = QImage(paddedWidth / scale(i), STRIP_HEIGHT / scale(i),
+                           QImage::Format_ARGB32_Premultiplied);
+    }
+
+    QImage strip(paddedWidth, STRIP_HEIGHT, QImage::Format_ARGB32_Premultiplied);
+    for (int top = 0; top < pixelHeight; top += STRIP_HEIGHT)
+    {
+        strip.fill(0);
+        foreach (const BackgroundBaker *layerRenderer, this->layerRenderers)
+            layerRenderer->renderStrip(QRect(0, top, paddedWidth, STRIP_HEIGHT), strip);
+
+        const int stripHeight = qMin((int) STRIP_HEIGHT, pixelHeight - top);
+        for (int i = 0; i < LEVEL_COUNT; ++i)
+        {
+            if (i == 0)
+                boxFilter(strip, levels[i], FIRST_SCALE);
+            else
+                boxFilter(levels[i - 1], levels[i], 2);
+
+            // partial strips (at the bottom) still cover whole output rows
+            int rows = (stripHeight + scale(i) - 1) / scale(i);
+            for (int y = 0; y < rows; ++y)
+                writers[i]->writeRow(reinterpret_cast<const QRgb *>(levels[i].constScanLine(y)));
+        }
+    }
+
+    QList<QByteArray> pngs;
+    for (int i = 0; i < LEVEL_COUNT; ++i)
+    {
+        if (!writers[i]->finish())
+        {
+            qWarning() << "Could not encode minimap at 1/" << scale(i) << " scale\n";
+            data[i].clear();
+        }
+        delete writers[i];
+        pngs.append(data[i]);
+    }
+    return pngs;
+}
+
+/**
+ * Function averages factor x factor blocks of premultiplied pixels.
+ *
+ * Two channels are summed per 32-bit addition (red and blue, then alpha
+ * and green, each in a 16-bit lane), which is exact up to 16x16 blocks.
+ * factor must be a power of two and the source size a multiple of it.
+ */
+void MinimapRenderer::boxFilter(const QImage &source, QImage &target, int factor)
+{
+    int shift = 0;
+    while ((1 << shift) < factor * factor) ++shift;
+    const quint32 rounding = ((factor * factor) / 2) * 0x00010001;
+
+    for (int y = 0; y < target.height(); ++y)
+    {
+        QRgb *out = reinterpret_cast<QRgb *>(target.scanLine(y));
+        for (int x = 0; x < target.width(); ++x)
+        {
+            quint32 rb = rounding, ag = rounding;
+            for (int dy = 0; dy < factor; ++dy)
+            {
+                const QRgb *in = reinterpret_cast<const QRgb *>(source.constScanLine(y * factor + dy))
+                                 + x * factor;
+                for (int dx = 0; dx < factor; ++dx)
+                {
+                    rb += in[dx] & 0x00FF00FF;
+                    ag += (in[dx] >> 8) & 0x00FF00FF;
+                }
+            }
+            out[x] = ((rb >> shift) & 0x00FF00FF) | (((ag >> shift) & 0x00FF00FF) << 8);
+        }
+    }
+}
@@ -0,0 +1,75 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef MINIMAPRENDERER_H
+#define MINIMAPRENDERER_H
+
+#include <QList>
+#include <QImage>
+#include <QByteArray>
+
+#include "compactmap.h"
+#include "backgroundbaker.h"
+
+namespace Flx
+{
+    /**
+     * Class renders downsampled overview images of a whole map (every
+     * visible layer) at 1/4, 1/8 and 1/16 scale.
+     *
+     * The map is composited one strip of rows at a time; each strip is box
+     * filtered to the largest scale and from there to the smaller ones, and
+     * the results go straight to streaming PNG writers. A full-resolution
+     * image of the map is never held.
+     */
+    class MinimapRenderer
+    {
+    public:
+        explicit MinimapRenderer(const CompactMap *map);
+        ~MinimapRenderer();
+
+        /**
+         * Function renders the overview images
+         *
+         * @return one PNG per level, largest first (empty if encoding failed)
+         */
+        QList<QByteArray> render() const;
+
+        /**
+         * @return how many map pixels one pixel of the given level covers
+         */
+        static int scale(int level) { return FIRST_SCALE << level; }
+
+        enum { LEVEL_COUNT = 3, FIRST_SCALE = 4 };
+
+    protected:
+        // map rows composited at a time (a multiple of the smallest scale)
+        enum { STRIP_HEIGHT = 64 };
+
+        static void boxFilter(const QImage &source, QImage &target, int factor);
+
+        const CompactMap *map;
+        QList<BackgroundBaker *> layerRenderers;
+    };
+}
+
+#endif // MINIMAPRENDERER_H
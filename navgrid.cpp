@@ -0,0 +1,156 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#include <QDataStream>
+
+#include "navgrid.h"
+
+using namespace Flx;
+
+namespace
+{
+    int findRoot(QVector<int> &parent, int label)
+    {
+        while (parent.at(label) != label)
+        {
+            parent[label] = parent.at(parent.at(label));     // path halving
+            label = parent.at(label);
+        }
+        return label;
+    }
+}
+
+NavGrid::NavGrid(const TileGrid &tiles, int collideIndex)
+    : mLabels(tiles.width(), tiles.height()),
+      mRegionCount(0)
+{
+    this->labelRegions(tiles, collideIndex);
+}
+
+/**
+ * Function labels the regions with two passes of union-find (linear in
+ * the number of cells, apart from the nearly constant find cost): the
+ * first pass gives every cell a provisional label and records which
+ * labels meet, the second replaces labels by consecutive region numbers.
+ */
+void NavGrid::labelRegions(const TileGrid &tiles, int collideIndex)
+{
+    const int width = tiles.width();
+    const int height = tiles.height();
+
+    QVector<int> parent;
+    parent.append(0);
+
+    for (int y = 0; y < height; ++y)
+    {
+        const int *row = tiles.constRow(y);
+        for (int x = 0; x < width; ++x)
+        {
+            if (row[x] != 0 && row[x] >= collideIndex)
+                continue;
+
+            int left = x > 0 ? mLabels.at(x - 1, y) : 0;
+            int up = y > 0 ? mLabels.at(x, y - 1) : 0;
+
+            int label;
+            if (left == 0 && up == 0)
+            {
+                label = parent.size();
+                parent.append(label);
+            }
+            else if (left == 0 || up == 0)
+            {
+                label = left | up;
+            }
+            else
+            {
+                int leftRoot = findRoot(parent, left);
+                int upRoot = findRoot(parent, up);
+                label = qMin(leftRoot, upRoot);
+                parent[qMax(leftRoot, upRoot)] = label;
+            }
+            mLabels.set(x, y, label);
+        }
+    }
+
+    QVector<int> region(parent.size(), 0);
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            int label = mLabels.at(x, y);
+            if (label == 0) continue;
+
+            int root = findRoot(parent, label);
+            if (region.at(root) == 0)
+                region[root] = ++mRegionCount;
+            mLabels.set(x, y, region.at(root));
+        }
+    }
+}
+
+QByteArray NavGrid::toBinary() const
+{
+    const int width = mLabels.width();
+    const int height = mLabels.height();
+    const int labelBytes = mRegionCount < 0x10000 ? 2 : 4;
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setByteOrder(QDataStream::BigEndian);
+
+    stream << quint32(width) << quint32(height)
+           << quint32(mRegionCount) << quint32(labelBytes);
+
+    quint8 bits = 0;
+    int bitCount = 0;
+    for (int y = 0; y < height; ++y)
+    {
+        const int *row = mLabels.constRow(y);
+        for (int x = 0; x < width; ++x)
+        {
+            bits = (bits << 1) | (row[x] != 0 ? 1 : 0);
+            if (++bitCount == 8)
+            {
+                stream << bits;
+                bits = 0;
+                bitCount = 0;
+            }
+        }
+    }
+    if (bitCount > 0)
+        stream << quint8(bits << (8 - bitCount));
+
+    for (int y = 0; y < height; ++y)
+    {
+        const int *row = mLabels.constRow(y);
+        for (int x = 0; x < width; ++x)
+        {
+            if (labelBytes == 2)
+                stream << quint16(row[x]);
+            else
+                stream << quint32(row[x]);
+        }
+    }
+
+    return data;
+}
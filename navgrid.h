@@ -0,0 +1,72 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef NAVGRID_H
+#define NAVGRID_H
+
+#include <QByteArray>
+#include <QVector>
+
+#include "tilegrid.h"
+
+namespace Flx
+{
+    /**
+     * Walkability of a collision layer and its connected regions.
+     *
+     * A cell is walkable if it is empty or holds a non-solid tile. Walkable
+     * cells that are 4-connected share a region label (1, 2, ...; blocked
+     * cells are 0), so two cells are mutually reachable exactly if their
+     * labels are equal.
+     */
+    class NavGrid
+    {
+    public:
+        /**
+         * @param tiles flixel tile indices of the layer
+         * @param collideIndex first solid tile index
+         */
+        NavGrid(const TileGrid &tiles, int collideIndex);
+
+        int regionCount() const { return mRegionCount; }
+        int region(int x, int y) const { return mLabels.at(x, y); }
+        bool isWalkable(int x, int y) const { return mLabels.at(x, y) != 0; }
+
+        /**
+         * Function packs the grid for embedding (big-endian, as read by
+         * ActionScript's ByteArray):
+         *
+         *   uint32 width, height, regionCount, labelBytes (2 or 4)
+         *   walkability bits, row-major, most significant bit first
+         *   region labels, row-major, labelBytes each
+         */
+        QByteArray toBinary() const;
+
+    protected:
+        void labelRegions(const TileGrid &tiles, int collideIndex);
+
+        TileGrid mLabels;
+        int mRegionCount;
+    };
+}
+
+#endif // NAVGRID_H
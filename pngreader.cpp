@@ -0,0 +1,339 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#include <QtEndian>
+#include <cstdlib>
+#include <cstring>
+
+#include "pngreader.h"
+
+using namespace Flx;
+
+namespace
+{
+    const uchar PNG_SIGNATURE[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+
+    inline int paeth(int a, int b, int c)
+    {
+        int p = a + b - c;
+        int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc) return a;
+        return pb <= pc ? b : c;
+    }
+
+    /**
+     * @return number of samples per pixel of a colour type, or 0 if the
+     *         combination of colour type and bit depth is invalid
+     */
+    int channelCount(int colorType, int bitDepth)
+    {
+        switch (colorType)
+        {
+        case 0: return (bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16) ? 1 : 0;
+        case 3: return (bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8) ? 1 : 0;
+        case 2: return (bitDepth == 8 || bitDepth == 16) ? 3 : 0;
+        case 4: return (bitDepth == 8 || bitDepth == 16) ? 2 : 0;
+        case 6: return (bitDepth == 8 || bitDepth == 16) ? 4 : 0;
+        default: return 0;
+        }
+    }
+}
+
+PngReader::PngReader(QIODevice *device)
+    : device(device),
+      mWidth(0),
+      mHeight(0),
+      bitDepth(0),
+      colorType(0),
+      channels(0),
+      rowBytes(0),
+      pixelBytes(1),
+      hasColorKey(false),
+      streamOpen(false),
+      dataRemaining(0)
+{
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    stream.next_in = Z_NULL;
+    stream.avail_in = 0;
+}
+
+PngReader::~PngReader()
+{
+    if (streamOpen)
+        inflateEnd(&stream);
+}
+
+bool PngReader::readHeader()
+{
+    QByteArray signature = this->device->read(8);
+    if (signature.size() != 8 || memcmp(signature.constData(), PNG_SIGNATURE, 8) != 0)
+        return false;
+
+    quint32 length;
+    QByteArray type;
+    while (this->readChunkHeader(length, type))
+    {
+        if (type == "IDAT")
+        {
+            if (this->channels == 0 || inflateInit(&stream) != Z_OK)
+                return false;
+
+            this->streamOpen = true;
+            this->dataRemaining = length;
+            this->previousRow = QVector<uchar>(this->rowBytes + 1, 0);
+            this->currentRow = QVector<uchar>(this->rowBytes + 1, 0);
+            return true;
+        }
+
+        if (type == "IHDR" || type == "PLTE" || type == "tRNS")
+        {
+            QByteArray data = this->device->read(length);
+            if (quint32(data.size()) != length || !this->skip(4))     // CRC
+                return false;
+            const uchar *d = reinterpret_cast<const uchar *>(data.constData());
+
+            if (type == "IHDR")
+            {
+                if (length < 13) return false;
+
+                this->mWidth = qFromBigEndian<quint32>(d);
+                this->mHeight = qFromBigEndian<quint32>(d + 4);
+                this->bitDepth = d[8];
+                this->colorType = d[9];
+                this->channels = channelCount(this->colorType, this->bitDepth);
+
+                // compression, filter method and interlacing
+                if (this->channels == 0 || d[10] != 0 || d[11] != 0 || d[12] != 0
+                    || this->mWidth <= 0 || this->mHeight <= 0)
+                {
+                    this->channels = 0;
+                    return false;
+                }
+
+                int bitsPerPixel = this->channels * this->bitDepth;
+                this->rowBytes = (this->mWidth * bitsPerPixel + 7) / 8;
+                this->pixelBytes = qMax(1, bitsPerPixel / 8);
+            }
+            else if (type == "PLTE")
+            {
+                this->palette.resize(length / 3);
+                for (int i = 0; i < this->palette.size(); ++i)
+                    this->palette[i] = qRgb(d[3 * i], d[3 * i + 1], d[3 * i + 2]);
+            }
+            else if (this->colorType == 3)
+            {
+                for (int i = 0; i < int(length) && i < this->palette.size(); ++i)
+                    this->palette[i] = (this->palette.at(i) & RGB_MASK) | (uint(d[i]) << 24);
+            }
+            else if ((this->colorType == 0 && length >= 2) || (this->colorType == 2 && length >= 6))
+            {
+                this->hasColorKey = true;
+                for (int i = 0; i < int(length / 2) && i < 3; ++i)
+                    this->colorKey[i] = qFromBigEndian<quint16>(d + 2 * i);
+            }
+        }
+        else if (!this->skip(qint64(length) + 4))
+        {
+            return false;
+        }
+    }
+
+    // IEND (or the end of the file) before any image data
+    return false;
+}
+
+bool PngReader::readChunkHeader(quint32 &length, QByteArray &type)
+{
+    QByteArray header = this->device->read(8);
+    if (header.size() != 8)
+        return false;
+
+    length = qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(header.constData()));
+    type = header.mid(4);
+    return type != "IEND";
+}
+
+bool PngReader::skip(qint64 length)
+{
+    if (!this->device->isSequential())
+        return this->device->seek(this->device->pos() + length);
+
+    return this->device->read(length).size() == length;
+}
+
+/**
+ * Function reads more compressed data, moving on to the next IDAT chunk
+ * when the current one is used up
+ */
+bool PngReader::fillInput()
+{
+    while (this->dataRemaining == 0)
+    {
+        quint32 length;
+        QByteArray type;
+        if (!this->skip(4) || !this->readChunkHeader(length, type) || type != "IDAT")
+            return false;
+        this->dataRemaining = length;
+    }
+
+    this->input = this->device->read(qMin(this->dataRemaining, quint32(INPUT_BUFFER_SIZE)));
+    if (this->input.isEmpty())
+        return false;
+
+    this->dataRemaining -= this->input.size();
+    stream.next_in = reinterpret_cast<Bytef *>(this->input.data());
+    stream.avail_in = this->input.size();
+    return true;
+}
+
+bool PngReader::readRow(QRgb *pixels)
+{
+    if (!this->streamOpen)
+        return false;
+
+    this->previousRow.swap(this->currentRow);
+
+    stream.next_out = this->currentRow.data();
+    stream.avail_out = this->currentRow.size();
+    while (stream.avail_out > 0)
+    {
+        if (stream.avail_in == 0 && !this->fillInput())
+            return false;
+
+        int ret = inflate(&stream, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END && stream.avail_out > 0)
+            return false;
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+            return false;
+    }
+
+    this->unfilterRow();
+    this->convertRow(pixels);
+    return true;
+}
+
+void PngReader::unfilterRow()
+{
+    uchar *row = this->currentRow.data() + 1;
+    const uchar *prior = this->previousRow.constData() + 1;
+    const int bpp = this->pixelBytes;
+
+    switch (this->currentRow.at(0))
+    {
+    case 1:     // sub
+        for (int i = bpp; i < this->rowBytes; ++i)
+            row[i] += row[i - bpp];
+        break;
+    case 2:     // up
+        for (int i = 0; i < this->rowBytes; ++i)
+            row[i] += prior[i];
+        break;
+    case 3:     // average
+        for (int i = 0; i < this->rowBytes; ++i)
+            row[i] += ((i >= bpp ? row[i - bpp] : 0) + prior[i]) / 2;
+        break;
+    case 4:     // paeth
+        for (int i = 0; i < this->rowBytes; ++i)
+            row[i] += paeth(i >= bpp ? row[i - bpp] : 0, prior[i], i >= bpp ? prior[i - bpp] : 0);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @return the raw value of the index-th sample of a row
+ */
+uint PngReader::sample(const uchar *data, int index) const
+{
+    switch (this->bitDepth)
+    {
+    case 16:
+        return qFromBigEndian<quint16>(data + 2 * index);
+    case 8:
+        return data[index];
+    default:
+    {
+        int bit = index * this->bitDepth;
+        return (data[bit / 8] >> (8 - this->bitDepth - bit % 8)) & ((1 << this->bitDepth) - 1);
+    }
+    }
+}
+
+int PngReader::scaleSample(uint value) const
+{
+    if (this->bitDepth == 16)
+        return value >> 8;
+    if (this->bitDepth < 8)
+        return value * 255 / ((1 << this->bitDepth) - 1);
+    return value;
+}
+
+void PngReader::convertRow(QRgb *pixels) const
+{
+    const uchar *data = this->currentRow.constData() + 1;
+
+    for (int x = 0; x < this->mWidth; ++x)
+    {
+        int s = x * this->channels;
+        switch (this->colorType)
+        {
+        case 0:
+        {
+            uint gray = this->sample(data, s);
+            int alpha = (this->hasColorKey && gray == this->colorKey[0]) ? 0 : 255;
+            int g = this->scaleSample(gray);
+            pixels[x] = qRgba(g, g, g, alpha);
+            break;
+        }
+        case 2:
+        {
+            uint r = this->sample(data, s), g = this->sample(data, s + 1), b = this->sample(data, s + 2);
+            bool keyed = this->hasColorKey
+                    && r == this->colorKey[0] && g == this->colorKey[1] && b == this->colorKey[2];
+            pixels[x] = qRgba(this->scaleSample(r), this->scaleSample(g), this->scaleSample(b),
+                              keyed ? 0 : 255);
+            break;
+        }
+        case 3:
+        {
+            uint index = this->sample(data, s);
+            pixels[x] = int(index) < this->palette.size() ? this->palette.at(index) : 0;
+            break;
+        }
+        case 4:
+        {
+            int g = this->scaleSample(this->sample(data, s));
+            pixels[x] = qRgba(g, g, g, this->scaleSample(this->sample(data, s + 1)));
+            break;
+        }
+        default:    // 6
+            pixels[x] = qRgba(this->scaleSample(this->sample(data, s)),
+                              this->scaleSample(this->sample(data, s + 1)),
+                              this->scaleSample(this->sample(data, s + 2)),
+                              this->scaleSample(this->sample(data, s + 3)));
+            break;
+        }
+    }
+}
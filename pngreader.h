@@ -0,0 +1,101 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef PNGREADER_H
+#define PNGREADER_H
+
+#include <QIODevice>
+#include <QVector>
+#include <QByteArray>
+#include <QColor>
+
+#include <zlib.h>
+
+namespace Flx
+{
+    /**
+     * Class decodes a PNG one row at a time, so that a caller only
+     * interested in the top part of an image can stop early and never
+     * holds more than a row of it.
+     *
+     * Interlaced images are not supported (readHeader fails); every bit
+     * depth and colour type, palettes and tRNS transparency are.
+     */
+    class PngReader
+    {
+    public:
+        explicit PngReader(QIODevice *device);
+        ~PngReader();
+
+        /**
+         * Function reads the chunks before the image data
+         *
+         * @return false if the image is not a PNG or cannot be streamed
+         */
+        bool readHeader();
+
+        int width() const { return mWidth; }
+        int height() const { return mHeight; }
+
+        /**
+         * Function decodes the next row
+         *
+         * @param pixels receives width pixels in QImage::Format_ARGB32
+         * @return false if the image data is corrupt or truncated
+         */
+        bool readRow(QRgb *pixels);
+
+    protected:
+        bool readChunkHeader(quint32 &length, QByteArray &type);
+        bool skip(qint64 length);
+        bool fillInput();
+        void unfilterRow();
+        void convertRow(QRgb *pixels) const;
+        uint sample(const uchar *data, int index) const;
+        int scaleSample(uint value) const;
+
+        enum { INPUT_BUFFER_SIZE = 64 * 1024 };
+
+        QIODevice *device;
+        int mWidth;
+        int mHeight;
+        int bitDepth;
+        int colorType;
+        int channels;
+        int rowBytes;
+        int pixelBytes;     // filter distance, at least 1
+
+        QVector<QRgb> palette;
+        bool hasColorKey;
+        uint colorKey[3];
+
+        bool streamOpen;
+        z_stream stream;
+        QByteArray input;
+        quint32 dataRemaining;     // in the current IDAT chunk
+
+        QVector<uchar> previousRow;
+        QVector<uchar> currentRow;     // filter type byte, then the row
+    };
+}
+
+#endif // PNGREADER_H
@@ -0,0 +1,218 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#include <QtEndian>
+#include <cstdlib>
+
+#include "pngwriter.h"
+
+using namespace Flx;
+
+namespace
+{
+    const uchar PNG_SIGNATURE[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+
+    inline int paeth(int a, int b, int c)
+    {
+        int p = a + b - c;
+        int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc) return a;
+        return pb <= pc ? b : c;
+    }
+}
+
+PngWriter::PngWriter(QIODevice *device, int width, int height)
+    : device(device),
+      width(width),
+      height(height),
+      rowsWritten(0),
+      mError(false),
+      output(OUTPUT_BUFFER_SIZE, 0),
+      previousRow(width * 4, 0),
+      currentRow(width * 4),
+      filteredRow(width * 4 + 1),
+      bestRow(width * 4 + 1)
+{
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    if (deflateInit(&stream, Z_DEFAULT_COMPRESSION) != Z_OK)
+        mError = true;
+
+    stream.next_out = reinterpret_cast<Bytef *>(output.data());
+    stream.avail_out = OUTPUT_BUFFER_SIZE;
+
+    if (this->device->write(reinterpret_cast<const char *>(PNG_SIGNATURE), 8) != 8)
+        mError = true;
+
+    QByteArray header(13, 0);
+    uchar *h = reinterpret_cast<uchar *>(header.data());
+    qToBigEndian<quint32>(width, h);
+    qToBigEndian<quint32>(height, h + 4);
+    h[8] = 8;       // bits per channel
+    h[9] = 6;       // RGBA
+    h[10] = 0;      // deflate
+    h[11] = 0;      // adaptive filtering
+    h[12] = 0;      // not interlaced
+    this->writeChunk("IHDR", header);
+}
+
+PngWriter::~PngWriter()
+{
+    deflateEnd(&stream);
+}
+
+/**
+ * Function converts the row to straight RGBA and tries every PNG filter
+ * on it, keeping the one with the smallest sum of absolute differences
+ * (the heuristic libpng uses).
+ */
+void PngWriter::writeRow(const QRgb *pixels)
+{
+    if (mError || this->rowsWritten >= this->height)
+        return;
+
+    uchar *row = this->currentRow.data();
+    for (int x = 0; x < this->width; ++x)
+    {
+        QRgb p = pixels[x];
+        int a = qAlpha(p);
+        uchar *out = row + x * 4;
+        if (a == 0)
+        {
+            out[0] = out[1] = out[2] = out[3] = 0;
+        }
+        else
+        {
+            out[0] = qMin(255, qRed(p) * 255 / a);
+            out[1] = qMin(255, qGreen(p) * 255 / a);
+            out[2] = qMin(255, qBlue(p) * 255 / a);
+            out[3] = a;
+        }
+    }
+
+    const uchar *prev = this->previousRow.constData();
+    const int size = this->width * 4;
+
+    int bestSum = -1;
+    for (int filter = 0; filter <= 4; ++filter)
+    {
+        uchar *f = this->filteredRow.data();
+        f[0] = filter;
+
+        int sum = 0;
+        for (int i = 0; i < size; ++i)
+        {
+            int left = i >= 4 ? row[i - 4] : 0;
+            int up = prev[i];
+            int upLeft = i >= 4 ? prev[i - 4] : 0;
+
+            int predicted;
+            switch (filter)
+            {
+            case 1:  predicted = left; break;
+            case 2:  predicted = up; break;
+            case 3:  predicted = (left + up) / 2; break;
+            case 4:  predicted = paeth(left, up, upLeft); break;
+            default: predicted = 0; break;
+            }
+
+            uchar value = uchar(row[i] - predicted);
+            f[i + 1] = value;
+            sum += value < 128 ? value : 256 - value;
+        }
+
+        if (bestSum < 0 || sum < bestSum)
+        {
+            bestSum = sum;
+            this->bestRow.swap(this->filteredRow);
+        }
+    }
+
+    this->deflateRow(this->bestRow.constData(), size + 1, Z_NO_FLUSH);
+    this->previousRow.swap(this->currentRow);
+    ++this->rowsWritten;
+}
+
+void PngWriter::deflateRow(const uchar *data, int size, int flush)
+{
+    stream.next_in = const_cast<Bytef *>(data);
+    stream.avail_in = size;
+
+    for (;;)
+    {
+        int ret = deflate(&stream, flush);
+        if (ret == Z_STREAM_ERROR)
+        {
+            mError = true;
+            return;
+        }
+
+        if (stream.avail_out == 0)
+            this->flushOutput();
+        else if (stream.avail_in == 0 && (flush == Z_NO_FLUSH || ret == Z_STREAM_END))
+            return;
+    }
+}
+
+void PngWriter::flushOutput()
+{
+    int size = OUTPUT_BUFFER_SIZE - stream.avail_out;
+    if (size > 0)
+        this->writeChunk("IDAT", QByteArray::fromRawData(this->output.constData(), size));
+
+    stream.next_out = reinterpret_cast<Bytef *>(this->output.data());
+    stream.avail_out = OUTPUT_BUFFER_SIZE;
+}
+
+bool PngWriter::finish()
+{
+    if (this->rowsWritten != this->height)
+        mError = true;
+
+    if (!mError)
+    {
+        this->deflateRow(NULL, 0, Z_FINISH);
+        this->flushOutput();
+        this->writeChunk("IEND", QByteArray());
+    }
+    return !mError;
+}
+
+void PngWriter::writeChunk(const char *type, const QByteArray &data)
+{
+    uchar length[4];
+    qToBigEndian<quint32>(data.size(), length);
+
+    uLong crc = crc32(0, reinterpret_cast<const Bytef *>(type), 4);
+    crc = crc32(crc, reinterpret_cast<const Bytef *>(data.constData()), data.size());
+    uchar crcBytes[4];
+    qToBigEndian<quint32>(crc, crcBytes);
+
+    if (this->device->write(reinterpret_cast<const char *>(length), 4) != 4
+        || this->device->write(type, 4) != 4
+        || this->device->write(data) != data.size()
+        || this->device->write(reinterpret_cast<const char *>(crcBytes), 4) != 4)
+    {
+        mError = true;
+    }
+}
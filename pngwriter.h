@@ -0,0 +1,87 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef PNGWRITER_H
+#define PNGWRITER_H
+
+#include <QIODevice>
+#include <QVector>
+#include <QByteArray>
+#include <QColor>
+
+#include <zlib.h>
+
+namespace Flx
+{
+    /**
+     * Class encodes a 32-bit RGBA PNG from rows handed in one at a time.
+     *
+     * Rows are filtered and deflated as they arrive and compressed data is
+     * written out in IDAT chunks as it fills up, so only a couple of rows
+     * are ever held, whatever the image size.
+     */
+    class PngWriter
+    {
+    public:
+        PngWriter(QIODevice *device, int width, int height);
+        ~PngWriter();
+
+        /**
+         * Function appends the next row
+         *
+         * @param pixels width pixels in QImage::Format_ARGB32_Premultiplied
+         */
+        void writeRow(const QRgb *pixels);
+
+        /**
+         * Function completes the image; all rows must have been written
+         *
+         * @return false if writing failed at any point
+         */
+        bool finish();
+
+        bool hasError() const { return mError; }
+
+    protected:
+        void writeChunk(const char *type, const QByteArray &data);
+        void deflateRow(const uchar *data, int size, int flush);
+        void flushOutput();
+
+        enum { OUTPUT_BUFFER_SIZE = 64 * 1024 };
+
+        QIODevice *device;
+        int width;
+        int height;
+        int rowsWritten;
+        bool mError;
+
+        z_stream stream;
+        QByteArray output;
+
+        QVector<uchar> previousRow;
+        QVector<uchar> currentRow;
+        QVector<uchar> filteredRow;
+        QVector<uchar> bestRow;
+    };
+}
+
+#endif // PNGWRITER_H
@@ -1,6 +1,8 @@
 #include "ProgressDialog.h"
 #include "ui_ProgressDialog.h"
 
+#include <QApplication>
+
 ProgressDialog::ProgressDialog(QWidget *parent) :
     QProgressDialog(parent),
     ui(new Ui::ProgressDialog)
@@ -28,6 +30,24 @@ void ProgressDialog::setMaxProgress(unsigned char pctg) const
     ui->progressBar->setMaximum(pctg);
 }
 
+void ProgressDialog::progressStarted(int steps)
+{
+    ui->progressBar->setValue(0);
+    ui->progressBar->setMaximum(steps);
+    this->open();
+}
+
+void ProgressDialog::progressStep()
+{
+    this->updateProgress();
+    QApplication::instance()->processEvents();
+}
+
+void ProgressDialog::progressFinished()
+{
+    this->close();
+}
+
 void ProgressDialog::changeEvent(QEvent *e)
 {
     QProgressDialog::changeEvent(e);
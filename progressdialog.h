@@ -3,11 +3,13 @@
 
 #include <QProgressDialog>
 
+#include "progresslistener.h"
+
 namespace Ui {
     class ProgressDialog;
 }
 
-class ProgressDialog : public QProgressDialog
+class ProgressDialog : public QProgressDialog, public Flx::ProgressListener
 {
     Q_OBJECT
 
@@ -19,6 +21,10 @@ public:
     void updateProgress(const unsigned char step = 1) const;
     void setMaxProgress(const unsigned char val) const;
 
+    void progressStarted(int steps);
+    void progressStep();
+    void progressFinished();
+
 protected:
     void changeEvent(QEvent *e);
 
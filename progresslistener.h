@@ -0,0 +1,42 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef PROGRESSLISTENER_H
+#define PROGRESSLISTENER_H
+
+namespace Flx
+{
+    /**
+     * Interface for reporting export progress (implemented by the progress
+     * dialog in the plugin; headless exports run without one)
+     */
+    class ProgressListener
+    {
+    public:
+        virtual ~ProgressListener() {}
+
+        virtual void progressStarted(int steps) = 0;
+        virtual void progressStep() = 0;
+        virtual void progressFinished() = 0;
+    };
+}
+
+#endif // PROGRESSLISTENER_H
@@ -11,11 +11,17 @@
 #include "tile.h"
 #include "tilelayer.h"
 
+#include "layerproperties.h"
+
 SettingsDialog::SettingsDialog(QWidget *parent) :
     QDialog(parent),
+    map(NULL),
     ui(new Ui::SettingsDialog)
 {
     ui->setupUi(this);
+
+    connect(ui->spriteThresholdBox, SIGNAL(valueChanged(int)),
+            this, SLOT(refreshSummary()));
 }
 
 SettingsDialog::~SettingsDialog()
@@ -72,6 +78,8 @@ const void SettingsDialog::generateSummary(const Tiled::Map *map) const
     QString unsupportedLayers;
     QString skippedLayers;
 
+    QString layerStats;
+
     bool variableTileSizes = false;
     bool unsupportedTileSizes = false;
     bool invalidMap = false;
@@ -92,6 +100,7 @@ const void SettingsDialog::generateSummary(const Tiled::Map *map) const
         {
             QTextStream(&exportedLayers) << layer->name() << "; ";
 
+            int usedCells = 0;
             for (int i = 0; i < layer->width(); ++i)
             {
                 for (int j = 0; j < layer->height(); ++j)
@@ -99,6 +108,8 @@ const void SettingsDialog::generateSummary(const Tiled::Map *map) const
                     Tiled::Tile *tile = layer->asTileLayer()->tileAt(i, j);
                     if (tile == NULL) continue;
 
+                    usedCells += (tile->width() / map->tileWidth()) * (tile->height() / map->tileHeight());
+
                     if (tile->height() != tile->width())
                         unsupportedTileSizes = true;
                     if (tile->height() != map->height())
@@ -111,9 +122,20 @@ const void SettingsDialog::generateSummary(const Tiled::Map *map) const
                 }
             }
 
+            int cellCount = layer->width() * layer->height();
+            // sprites are not solid, so collision layers stay tilemaps
+            bool asSprites = !layer->properties()->contains(FlxLayerProperties::COLLISION)
+                    && usedCells * 100 < cellCount * this->getSpriteListThreshold();
+            QTextStream(&layerStats)
+                    << layer->name() << ": "
+                    << usedCells << "/" << cellCount << " cells used ("
+                    << QString::number(cellCount > 0 ? 100.0 * usedCells / cellCount : 0.0, 'f', 1) << "%), "
+                    << (asSprites ? "exported as sprite list" : "exported as tilemap")
+                    << "<br/>";
         }
     }
 
+    this->ui->overviewEdit->clear();
     this->ui->overviewEdit->insertHtml(h1.arg("Export Summary"));
 
     if (invalidMap)
@@ -130,6 +152,9 @@ const void SettingsDialog::generateSummary(const Tiled::Map *map) const
     if (exportedLayers.isEmpty()) exportedLayers = "<span style=\"font-weight:600;\">no layers will be exported</span>";
     this->ui->overviewEdit->insertHtml(p.arg(QString("<span style=\"font-weight:600;\">Exported layers</span>: %1").arg(exportedLayers)));
 
+    if (!layerStats.isEmpty())
+        this->ui->overviewEdit->insertHtml(p.arg(QString("<span style=\"font-weight:600;\">Layer usage</span>:<br/>%1").arg(layerStats)));
+
     if (!skippedLayers.isEmpty())
         this->ui->overviewEdit->insertHtml(p.arg(QString("<span style=\"font-weight:600;\">Skipped layers</span>: %1").arg(skippedLayers)));
 
@@ -156,6 +181,96 @@ const QString SettingsDialog::getTilemapClass() const
             : this->ui->tilemapClassEdit->text();
 }
 
+/**
+ * @return Percentage of used cells below which a layer is exported as a
+ *         list of sprites instead of a tilemap (0 = never)
+ */
+int SettingsDialog::getSpriteListThreshold() const
+{
+    return this->ui->spriteThresholdBox->value();
+}
+
+/**
+ * @return true if non-overlapping layers should share a tilemap
+ */
+bool SettingsDialog::mergeLayers() const
+{
+    return this->ui->mergeLayersBox->isChecked();
+}
+
+/**
+ * @return Percentage of opaque pixels from which tiles without a 'solid'
+ *         property count as solid (0 = every tile is solid)
+ */
+int SettingsDialog::getSolidCoverageThreshold() const
+{
+    return this->ui->solidCoverageBox->value();
+}
+
+/**
+ * @return true if tile IDs should be ordered by how often tiles are used
+ */
+bool SettingsDialog::frequencyOrder() const
+{
+    return this->ui->frequencyOrderBox->isChecked();
+}
+
+/**
+ * @return true if tilemaps should be loaded on first use
+ */
+bool SettingsDialog::lazyTilemaps() const
+{
+    return this->ui->lazyTilemapsBox->isChecked();
+}
+
+/**
+ * @return true if tiles bigger than a cell should be exported as sprites
+ */
+bool SettingsDialog::largeTileSprites() const
+{
+    return this->ui->largeTileSpritesBox->isChecked();
+}
+
+/**
+ * @return true if minimap images should be exported
+ */
+bool SettingsDialog::minimaps() const
+{
+    return this->ui->minimapsBox->isChecked();
+}
+
+/**
+ * @return true if the generated class should measure its loading
+ */
+bool SettingsDialog::loadStats() const
+{
+    return this->ui->loadStatsBox->isChecked();
+}
+
+/**
+ * @return true if a tile usage report should be written
+ */
+bool SettingsDialog::tileUsageReport() const
+{
+    return this->ui->tileUsageReportBox->isChecked();
+}
+
+/**
+ * @return true if the level should also be written as JSON
+ */
+bool SettingsDialog::jsonOutput() const
+{
+    return this->ui->jsonOutputBox->isChecked();
+}
+
+/**
+ * @return true if the level should also be written as binary data
+ */
+bool SettingsDialog::binaryOutput() const
+{
+    return this->ui->binaryOutputBox->isChecked();
+}
+
 bool SettingsDialog::exportCollisionData(const QString &name) const
 {
     /*for (int i = 0; i < this->ui->listWidget->count(); ++i)
@@ -179,6 +294,8 @@ void SettingsDialog::setPackageHints(const QStringList &list)
 
 void SettingsDialog::setMap(const Tiled::Map *map)
 {
+    this->map = map;
+
     /*foreach (Tiled::Layer *layer, map->layers())
     {
 
@@ -190,6 +307,15 @@ void SettingsDialog::setMap(const Tiled::Map *map)
     }*/
 }
 
+/**
+ * Function regenerates the summary after an option affecting it has changed
+ */
+void SettingsDialog::refreshSummary()
+{
+    if (this->map != NULL)
+        this->generateSummary(this->map);
+}
+
 void SettingsDialog::changeEvent(QEvent *e)
 {
     QDialog::changeEvent(e);
@@ -23,15 +23,28 @@ public:
 
     const QString getPackageName() const;
     const QString getTilemapClass() const;
+    int getSpriteListThreshold() const;
+    bool mergeLayers() const;
+    int getSolidCoverageThreshold() const;
+    bool frequencyOrder() const;
+    bool lazyTilemaps() const;
+    bool largeTileSprites() const;
+    bool minimaps() const;
+    bool loadStats() const;
+    bool tileUsageReport() const;
+    bool jsonOutput() const;
+    bool binaryOutput() const;
     const void generateSummary(const Tiled::Map *map) const;
     const void enableDerivedClassOption(const QString &name);
 
     const QString getDerivedFileName() const;
 
 protected slots:
+    void refreshSummary();
 
 protected:
     QString derivedFileName;
+    const Tiled::Map *map;
 
     void changeEvent(QEvent *e);
 
@@ -0,0 +1,57 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#include <QTextStream>
+
+#include "stringtable.h"
+
+using namespace Flx;
+
+int StringTable::intern(const QString &string)
+{
+    QHash<QString, int>::const_iterator it = mIndices.constFind(string);
+    if (it != mIndices.constEnd())
+        return it.value();
+
+    int index = mStrings.count();
+    mStrings.append(string);
+    mIndices.insert(string, index);
+    return index;
+}
+
+QString StringTable::declaration(const QString &varName) const
+{
+    QString result;
+    QTextStream stream(&result);
+
+    stream << "protected static const " << varName << ": Array = [";
+    for (int i = 0; i < mStrings.count(); ++i)
+    {
+        QString escaped(mStrings.at(i));
+        escaped.replace("\\", "\\\\").replace("\"", "\\\"").replace("\n", "\\n");
+        stream << (i == 0 ? "\"" : ", \"") << escaped << "\"";
+    }
+    stream << "];\n\t\t";
+    stream.flush();
+
+    return result;
+}
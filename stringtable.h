@@ -0,0 +1,58 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef STRINGTABLE_H
+#define STRINGTABLE_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+
+namespace Flx
+{
+    /**
+     * Interned strings of a level; generated data refers to them by index
+     * instead of repeating literals
+     */
+    class StringTable
+    {
+    public:
+        /**
+         * @return index of the string, which is added if it is new
+         */
+        int intern(const QString &string);
+
+        bool isEmpty() const { return mStrings.isEmpty(); }
+        const QStringList &strings() const { return mStrings; }
+
+        /**
+         * @return declaration of the table as an ActionScript array constant
+         */
+        QString declaration(const QString &varName) const;
+
+    protected:
+        QStringList mStrings;
+        QHash<QString, int> mIndices;
+    };
+}
+
+#endif // STRINGTABLE_H
@@ -0,0 +1,210 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <QMutexLocker>
+
+#include "tilecache.h"
+
+using namespace Flx;
+
+namespace Flx
+{
+    uint qHash(const TileCache::PartsKey &key)
+    {
+        return ::qHash(key.imageKey) ^ ::qHash((key.partWidth << 16) | key.partHeight);
+    }
+}
+
+bool TileCache::PartsKey::operator==(const PartsKey &other) const
+{
+    return imageKey == other.imageKey
+            && partWidth == other.partWidth && partHeight == other.partHeight;
+}
+
+TileCache::TileCache()
+{
+    this->setMemoryBudget(DEFAULT_MEMORY_BUDGET);
+}
+
+/**
+ * Most of the budget goes to tile parts, which are reused across layers
+ * and maps; a quarter keeps recently encoded sheets and a small share the
+ * analysis results.
+ */
+void TileCache::setMemoryBudget(int bytes)
+{
+    QMutexLocker locker(&this->mutex);
+    int analysisBytes = bytes / 32;
+    this->parts.setMaxCost(bytes - bytes / 4 - 2 * analysisBytes);
+    this->encodedSheets.setMaxCost(bytes / 4);
+    this->transparentTiles.setMaxCost(analysisBytes);
+    this->tileCoverage.setMaxCost(analysisBytes);
+}
+
+QList<QImage> TileCache::tileParts(CompactTileset *tileset, int id, int partWidth, int partHeight)
+{
+    PartsKey key;
+    key.imageKey = tileset->tileImageKey(id);
+    key.partWidth = partWidth;
+    key.partHeight = partHeight;
+
+    {
+        QMutexLocker locker(&this->mutex);
+        if (QList<QImage> *cached = this->parts.object(key))
+            return *cached;
+    }
+
+    // slicing happens unlocked; two threads missing the same key only
+    // duplicate work
+    QImage image = tileset->tileImage(id).convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    QList<QImage> *sliced = new QList<QImage>();
+    int cost = 0;
+    for (int y = 0; y + partHeight <= image.height(); y += partHeight)
+    {
+        for (int x = 0; x + partWidth <= image.width(); x += partWidth)
+        {
+            QImage part = image.copy(x, y, partWidth, partHeight);
+            cost += part.byteCount();
+            sliced->append(part);
+        }
+    }
+
+    QList<QImage> result = *sliced;
+    QMutexLocker locker(&this->mutex);
+    this->parts.insert(key, sliced, cost);     // takes ownership, may delete right away
+    return result;
+}
+
+bool TileCache::findEncodedSheet(const QByteArray &signature, QByteArray &png)
+{
+    QMutexLocker locker(&this->mutex);
+    QByteArray *cached = this->encodedSheets.object(signature);
+    if (!cached)
+        return false;
+
+    png = *cached;
+    return true;
+}
+
+void TileCache::insertEncodedSheet(const QByteArray &signature, const QByteArray &png)
+{
+    QMutexLocker locker(&this->mutex);
+    this->encodedSheets.insert(signature, new QByteArray(png), png.size());
+}
+
+TileCache *TileCache::instance()
+{
+    static TileCache cache;
+    return &cache;
+}
+
+bool TileCache::isTransparent(CompactTileset *tileset, int id)
+{
+    qint64 imageKey = tileset->tileImageKey(id);
+
+    {
+        QMutexLocker locker(&this->mutex);
+        if (bool *cached = this->transparentTiles.object(imageKey))
+            return *cached;
+    }
+
+    bool transparent = isTransparent(tileset->tileImage(id));
+    QMutexLocker locker(&this->mutex);
+    this->transparentTiles.insert(imageKey, new bool(transparent), ANALYSIS_ENTRY_COST);
+    return transparent;
+}
+
+qreal TileCache::opaqueCoverage(CompactTileset *tileset, int id)
+{
+    qint64 imageKey = tileset->tileImageKey(id);
+
+    {
+        QMutexLocker locker(&this->mutex);
+        if (qreal *cached = this->tileCoverage.object(imageKey))
+            return *cached;
+    }
+
+    qreal coverage = opaqueCoverage(tileset->tileImage(id));
+    QMutexLocker locker(&this->mutex);
+    this->tileCoverage.insert(imageKey, new qreal(coverage), ANALYSIS_ENTRY_COST);
+    return coverage;
+}
+
+qreal TileCache::opaqueCoverage(const QImage &image)
+{
+    if (image.isNull())
+        return 0;
+    if (!image.hasAlphaChannel())
+        return 1;
+
+    QImage argb = image.convertToFormat(QImage::Format_ARGB32);
+
+    int opaque = 0;
+    const int width = argb.width();
+    for (int y = 0; y < argb.height(); ++y)
+    {
+        const quint32 *line = reinterpret_cast<const quint32 *>(argb.constScanLine(y));
+        for (int x = 0; x < width; ++x)
+            opaque += (line[x] >> 31);      // alpha >= 128
+    }
+    return qreal(opaque) / (width * argb.height());
+}
+
+/**
+ * Function scans the alpha channel a whole scanline at a time: pixels are
+ * OR-ed together into an accumulator (a reduction the compiler turns into
+ * SIMD code) and only the accumulated alpha byte is tested per line.
+ */
+bool TileCache::isTransparent(const QImage &image)
+{
+    if (!image.hasAlphaChannel())
+        return false;
+
+    QImage argb = image;
+    if (argb.format() != QImage::Format_ARGB32
+        && argb.format() != QImage::Format_ARGB32_Premultiplied)
+    {
+        argb = argb.convertToFormat(QImage::Format_ARGB32);
+    }
+
+    const int width = argb.width();
+    for (int y = 0; y < argb.height(); ++y)
+    {
+        const quint32 *line = reinterpret_cast<const quint32 *>(argb.constScanLine(y));
+
+        quint32 acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+        int x = 0;
+        for (; x + 4 <= width; x += 4)
+        {
+            acc0 |= line[x];
+            acc1 |= line[x + 1];
+            acc2 |= line[x + 2];
+            acc3 |= line[x + 3];
+        }
+        for (; x < width; ++x)
+            acc0 |= line[x];
+
+        if ((acc0 | acc1 | acc2 | acc3) & 0xFF000000)
+            return false;
+    }
+    return true;
+}
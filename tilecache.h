@@ -0,0 +1,119 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include <QHash>
+#include <QCache>
+#include <QImage>
+#include <QList>
+#include <QByteArray>
+#include <QMutex>
+
+#include "compactmap.h"
+
+namespace Flx
+{
+    /**
+     * Class caches per-tile image analysis for as long as the plugin is
+     * loaded, so that repeated exports in one Tiled session can reuse it.
+     *
+     * Entries are keyed by the tile image key (see
+     * CompactTileset::tileImageKey), so reloaded tileset images are
+     * analysed again while tilesets recreated for every export still hit.
+     *
+     * Sliced tile parts, encoded tilesheets and the per-tile analysis
+     * results share a memory budget; the least recently used ones are
+     * evicted first, so keys of superseded images eventually drop out.
+     *
+     * Thread-safe, so that levels can be exported in parallel; the tileset
+     * passed in must not be shared between threads though.
+     */
+    class TileCache
+    {
+    public:
+        static TileCache *instance();
+
+        /**
+         * @return true if every pixel of the tile image is fully transparent
+         */
+        bool isTransparent(CompactTileset *tileset, int id);
+
+        static bool isTransparent(const QImage &image);
+
+        /**
+         * @return share of the tile's pixels that are at least half opaque
+         */
+        qreal opaqueCoverage(CompactTileset *tileset, int id);
+
+        static qreal opaqueCoverage(const QImage &image);
+
+        /**
+         * @return the tile image cut into partWidth x partHeight pieces,
+         *         row by row from the top-left
+         */
+        QList<QImage> tileParts(CompactTileset *tileset, int id, int partWidth, int partHeight);
+
+        /**
+         * Function looks up a previously encoded tilesheet
+         *
+         * @param signature identifies the sheet layout and the tile images in it
+         * @return false if the sheet is not cached
+         */
+        bool findEncodedSheet(const QByteArray &signature, QByteArray &png);
+        void insertEncodedSheet(const QByteArray &signature, const QByteArray &png);
+
+        /**
+         * Function sets the memory used for tile parts, sheets and analysis
+         * results, in bytes
+         */
+        void setMemoryBudget(int bytes);
+
+        static const int DEFAULT_MEMORY_BUDGET = 64 * 1024 * 1024;
+
+    protected:
+        TileCache();
+
+        struct PartsKey
+        {
+            qint64 imageKey;
+            int partWidth;
+            int partHeight;
+
+            bool operator==(const PartsKey &other) const;
+        };
+        friend uint qHash(const PartsKey &key);
+
+        QCache<PartsKey, QList<QImage> > parts;
+        QCache<QByteArray, QByteArray> encodedSheets;
+
+        // cost of one analysis result, including the cache's own node
+        static const int ANALYSIS_ENTRY_COST = 64;
+
+        QCache<qint64, bool> transparentTiles;    // by tile image key
+        QCache<qint64, qreal> tileCoverage;       // by tile image key
+
+        QMutex mutex;
+    };
+}
+
+#endif // TILECACHE_H
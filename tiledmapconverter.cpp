@@ -0,0 +1,123 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <QHash>
+#include <QDebug>
+
+#include "tilelayer.h"
+#include "layer.h"
+#include "tile.h"
+
+#include "tiledmapconverter.h"
+
+using namespace Flx;
+
+TiledTileset::TiledTileset(int firstGid, const Tiled::Tileset *tileset)
+    : CompactTileset(firstGid),
+      tileset(tileset)
+{
+}
+
+void TiledTileset::load()
+{
+    mName = this->tileset->name();
+    mTileWidth = this->tileset->tileWidth();
+    mTileHeight = this->tileset->tileHeight();
+    mTileCount = this->tileset->tileCount();
+}
+
+QImage TiledTileset::tileImage(int id)
+{
+    Tiled::Tile *tile = this->tileset->tileAt(id);
+    return tile != NULL ? tile->image().toImage() : QImage();
+}
+
+qint64 TiledTileset::tileImageKey(int id)
+{
+    Tiled::Tile *tile = this->tileset->tileAt(id);
+    return tile != NULL ? tile->image().cacheKey() : 0;
+}
+
+QMap<QString, QString> TiledTileset::tileProperties(int id)
+{
+    Tiled::Tile *tile = this->tileset->tileAt(id);
+    return tile != NULL ? *tile->properties() : QMap<QString, QString>();
+}
+
+CompactMap *TiledMapConverter::convert(const Tiled::Map *map)
+{
+    CompactMap *result = new CompactMap();
+    result->width = map->width();
+    result->height = map->height();
+    result->tileWidth = map->tileWidth();
+    result->tileHeight = map->tileHeight();
+
+    QHash<const Tiled::Tileset *, int> firstGids;
+    int firstGid = 1;
+    foreach (Tiled::Tileset *tileset, map->tilesets())
+    {
+        firstGids.insert(tileset, firstGid);
+        result->tilesets.append(new TiledTileset(firstGid, tileset));
+        firstGid += tileset->tileCount();
+    }
+
+    foreach (Tiled::Layer *layer, map->layers())
+    {
+        Tiled::TileLayer *tileLayer = layer->asTileLayer();
+        if (!tileLayer)
+        {
+            if (layer->isVisible() && layer->asObjectGroup())
+                qCritical() << "Object layers not supported yet. Ignoring layer '" << layer->name() << "'\n";
+            continue;
+        }
+
+        CompactLayer *compactLayer = new CompactLayer();
+        compactLayer->name = layer->name();
+        compactLayer->visible = layer->isVisible();
+        compactLayer->opacity = layer->opacity();
+        compactLayer->properties = *layer->properties();
+        compactLayer->gids = TileGrid(layer->width(), layer->height());
+
+        // neighbouring cells mostly come from the same tileset
+        const Tiled::Tileset *lastTileset = NULL;
+        int lastFirstGid = 0;
+
+        for (int j = 0; j < tileLayer->height(); ++j)
+        {
+            for (int i = 0; i < tileLayer->width(); ++i)
+            {
+                Tiled::Tile *tile = tileLayer->tileAt(i, j);
+                if (tile == NULL) continue;
+
+                if (tile->tileset() != lastTileset)
+                {
+                    lastTileset = tile->tileset();
+                    lastFirstGid = firstGids.value(lastTileset);
+                }
+                compactLayer->gids.set(i, j, lastFirstGid + tile->id());
+            }
+        }
+
+        result->addLayer(compactLayer);
+    }
+
+    return result;
+}
@@ -0,0 +1,62 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef TILEDMAPCONVERTER_H
+#define TILEDMAPCONVERTER_H
+
+#include "map.h"
+#include "tileset.h"
+
+#include "compactmap.h"
+
+namespace Flx
+{
+    /**
+     * Tileset backed by a tileset loaded in Tiled
+     */
+    class TiledTileset : public CompactTileset
+    {
+    public:
+        TiledTileset(int firstGid, const Tiled::Tileset *tileset);
+
+        QImage tileImage(int id);
+        qint64 tileImageKey(int id);
+        QMap<QString, QString> tileProperties(int id);
+
+    protected:
+        void load();
+
+        const Tiled::Tileset *tileset;
+    };
+
+    /**
+     * Class converts a map opened in Tiled into the compact form the export
+     * works on. Only visible and hidden tile layers are converted; object
+     * layers are skipped.
+     */
+    class TiledMapConverter
+    {
+    public:
+        static CompactMap *convert(const Tiled::Map *map);
+    };
+}
+
+#endif // TILEDMAPCONVERTER_H
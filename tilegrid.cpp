@@ -0,0 +1,147 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <cstring>
+
+#include "tilegrid.h"
+
+using namespace Flx;
+
+TileGrid::TileGrid()
+    : mWidth(0), mHeight(0)
+{
+}
+
+TileGrid::TileGrid(int width, int height, int fill)
+    : mWidth(width), mHeight(height), mCells(width * height, fill)
+{
+}
+
+QRect TileGrid::occupiedBounds() const
+{
+    int left = mWidth, right = -1;
+    int top = mHeight, bottom = -1;
+
+    for (int y = 0; y < mHeight; ++y)
+    {
+        const int *row = this->constRow(y);
+
+        int first = 0;
+        while (first < mWidth && row[first] == 0) ++first;
+        if (first == mWidth) continue;
+
+        int last = mWidth - 1;
+        while (row[last] == 0) --last;
+
+        if (first < left) left = first;
+        if (last > right) right = last;
+        if (top == mHeight) top = y;
+        bottom = y;
+    }
+
+    if (right < 0)
+        return QRect();
+
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+int TileGrid::occupiedCount() const
+{
+    int count = 0;
+    for (int i = 0; i < mCells.size(); ++i)
+        if (mCells.at(i) != 0) ++count;
+    return count;
+}
+
+bool TileGrid::overlaps(const TileGrid &other) const
+{
+    if (mWidth != other.mWidth || mHeight != other.mHeight)
+        return true;
+
+    const int *a = mCells.constData();
+    const int *b = other.mCells.constData();
+    for (int i = 0; i < mCells.size(); ++i)
+        if (a[i] != 0 && b[i] != 0) return true;
+
+    return false;
+}
+
+void TileGrid::overlay(const TileGrid &other)
+{
+    Q_ASSERT(mWidth == other.mWidth && mHeight == other.mHeight);
+
+    const int *src = other.mCells.constData();
+    for (int i = 0; i < mCells.size(); ++i)
+        if (src[i] != 0) mCells[i] = src[i];
+}
+
+bool TileGrid::rowEquals(const TileGrid &other, int y) const
+{
+    Q_ASSERT(mWidth == other.mWidth);
+    return memcmp(this->constRow(y), other.constRow(y), mWidth * sizeof(int)) == 0;
+}
+
+QRect TileGrid::differingBounds(const TileGrid &other) const
+{
+    if (mWidth != other.mWidth || mHeight != other.mHeight)
+        return QRect(0, 0, mWidth, mHeight);
+
+    int left = mWidth, right = -1;
+    int top = mHeight, bottom = -1;
+
+    for (int y = 0; y < mHeight; ++y)
+    {
+        // most rows of a small edit are unchanged
+        if (this->rowEquals(other, y)) continue;
+
+        const int *a = this->constRow(y);
+        const int *b = other.constRow(y);
+
+        int first = 0;
+        while (a[first] == b[first]) ++first;
+        int last = mWidth - 1;
+        while (a[last] == b[last]) --last;
+
+        if (first < left) left = first;
+        if (last > right) right = last;
+        if (top == mHeight) top = y;
+        bottom = y;
+    }
+
+    if (right < 0)
+        return QRect();
+
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+TileGrid TileGrid::copy(const QRect &rect) const
+{
+    QRect r = rect & QRect(0, 0, mWidth, mHeight);
+    TileGrid result(r.width(), r.height());
+
+    for (int y = 0; y < r.height(); ++y)
+    {
+        const int *src = this->constRow(r.y() + y) + r.x();
+        for (int x = 0; x < r.width(); ++x)
+            result.set(x, y, src[x]);
+    }
+    return result;
+}
@@ -0,0 +1,91 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef TILEGRID_H
+#define TILEGRID_H
+
+#include <QVector>
+#include <QRect>
+
+namespace Flx
+{
+    /**
+     * Dense, row-major grid of flixel tile indices (0 = empty cell)
+     */
+    class TileGrid
+    {
+    public:
+        TileGrid();
+        TileGrid(int width, int height, int fill = 0);
+
+        int width() const { return mWidth; }
+        int height() const { return mHeight; }
+
+        bool contains(int x, int y) const
+        { return x >= 0 && y >= 0 && x < mWidth && y < mHeight; }
+
+        int at(int x, int y) const { return mCells.at(y * mWidth + x); }
+        void set(int x, int y, int value) { mCells[y * mWidth + x] = value; }
+
+        const int *constRow(int y) const { return mCells.constData() + y * mWidth; }
+
+        /**
+         * @return smallest rectangle containing every non-empty cell
+         *         (a null rectangle if the grid is empty)
+         */
+        QRect occupiedBounds() const;
+
+        int occupiedCount() const;
+
+        TileGrid copy(const QRect &rect) const;
+
+        /**
+         * @return true if both grids have a non-empty cell at the same
+         *         position (grids of different size always overlap)
+         */
+        bool overlaps(const TileGrid &other) const;
+
+        /**
+         * Function copies every non-empty cell of a grid of the same size
+         */
+        void overlay(const TileGrid &other);
+
+        /**
+         * @return true if row y holds the same cells in both grids (which
+         *         must have the same width)
+         */
+        bool rowEquals(const TileGrid &other, int y) const;
+
+        /**
+         * @return smallest rectangle containing every cell that differs
+         *         from the other grid (the whole grid if the sizes differ,
+         *         a null rectangle if nothing does)
+         */
+        QRect differingBounds(const TileGrid &other) const;
+
+    protected:
+        int mWidth;
+        int mHeight;
+        QVector<int> mCells;
+    };
+}
+
+#endif // TILEGRID_H
@@ -0,0 +1,169 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#include <qmath.h>
+
+#include "tileoutline.h"
+
+using namespace Flx;
+
+const qreal TileOutline::DEFAULT_TOLERANCE = 1.0;
+
+namespace
+{
+    enum Step { NONE, UP, DOWN, LEFT, RIGHT };
+
+    inline bool isOpaque(const QImage &image, int x, int y)
+    {
+        return x >= 0 && y >= 0 && x < image.width() && y < image.height()
+                && qAlpha(image.pixel(x, y)) >= 128;
+    }
+}
+
+QPolygon TileOutline::trace(const QImage &source)
+{
+    QImage image = source.convertToFormat(QImage::Format_ARGB32);
+
+    // the outline starts at the top-left corner of the first opaque pixel
+    QPoint start(-1, -1);
+    for (int y = 0; y < image.height() && start.x() < 0; ++y)
+        for (int x = 0; x < image.width(); ++x)
+            if (isOpaque(image, x, y))
+            {
+                start = QPoint(x, y);
+                break;
+            }
+
+    QPolygon outline;
+    if (start.x() < 0)
+        return outline;
+
+    // every corner is visited at most twice (saddles), which bounds the walk
+    const int maxSteps = 2 * (image.width() + 1) * (image.height() + 1);
+
+    int x = start.x(), y = start.y();
+    Step previous = NONE;
+    for (int i = 0; i < maxSteps; ++i)
+    {
+        // the four pixels around corner (x, y)
+        int state = (isOpaque(image, x - 1, y - 1) ? 1 : 0)
+                | (isOpaque(image, x, y - 1) ? 2 : 0)
+                | (isOpaque(image, x - 1, y) ? 4 : 0)
+                | (isOpaque(image, x, y) ? 8 : 0);
+
+        Step next;
+        switch (state)
+        {
+        case 1: case 5: case 13:    next = UP; break;
+        case 2: case 3: case 7:     next = RIGHT; break;
+        case 4: case 12: case 14:   next = LEFT; break;
+        case 8: case 10: case 11:   next = DOWN; break;
+        case 6:                     next = previous == UP ? LEFT : RIGHT; break;
+        case 9:                     next = previous == RIGHT ? UP : DOWN; break;
+        default:                    return QPolygon();
+        }
+
+        // only corners where the direction changes are vertices
+        if (next != previous)
+            outline.append(QPoint(x, y));
+
+        switch (next)
+        {
+        case UP:    --y; break;
+        case DOWN:  ++y; break;
+        case LEFT:  --x; break;
+        default:    ++x; break;
+        }
+        previous = next;
+
+        if (x == start.x() && y == start.y())
+            return outline;
+    }
+
+    return outline;
+}
+
+QPolygon TileOutline::simplify(const QPolygon &polygon, qreal tolerance)
+{
+    if (polygon.size() < 4)
+        return polygon;
+
+    // a closed outline is simplified as two chains between the first
+    // vertex and the vertex farthest from it
+    int far = 0;
+    int farDistance = -1;
+    for (int i = 1; i < polygon.size(); ++i)
+    {
+        QPoint d = polygon.at(i) - polygon.first();
+        if (d.x() * d.x() + d.y() * d.y() > farDistance)
+        {
+            farDistance = d.x() * d.x() + d.y() * d.y();
+            far = i;
+        }
+    }
+
+    QPolygon closed(polygon);
+    closed.append(polygon.first());
+
+    QVector<bool> keep(closed.size(), false);
+    keep[0] = keep[far] = keep[closed.size() - 1] = true;
+    simplifyRange(closed, 0, far, tolerance, keep);
+    simplifyRange(closed, far, closed.size() - 1, tolerance, keep);
+
+    QPolygon result;
+    for (int i = 0; i < closed.size() - 1; ++i)
+        if (keep.at(i)) result.append(closed.at(i));
+    return result;
+}
+
+void TileOutline::simplifyRange(const QPolygon &polygon, int first, int last,
+                                qreal tolerance, QVector<bool> &keep)
+{
+    if (last - first < 2)
+        return;
+
+    const QPointF a = polygon.at(first);
+    const QPointF b = polygon.at(last);
+    const qreal length = qSqrt((b.x() - a.x()) * (b.x() - a.x()) + (b.y() - a.y()) * (b.y() - a.y()));
+
+    int farthest = first;
+    qreal maxDistance = -1;
+    for (int i = first + 1; i < last; ++i)
+    {
+        const QPointF p = polygon.at(i);
+        qreal distance = length > 0
+                ? qAbs((b.x() - a.x()) * (a.y() - p.y()) - (a.x() - p.x()) * (b.y() - a.y())) / length
+                : qSqrt((p.x() - a.x()) * (p.x() - a.x()) + (p.y() - a.y()) * (p.y() - a.y()));
+        if (distance > maxDistance)
+        {
+            maxDistance = distance;
+            farthest = i;
+        }
+    }
+
+    if (maxDistance <= tolerance)
+        return;
+
+    keep[farthest] = true;
+    simplifyRange(polygon, first, farthest, tolerance, keep);
+    simplifyRange(polygon, farthest, last, tolerance, keep);
+}
@@ -0,0 +1,60 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef TILEOUTLINE_H
+#define TILEOUTLINE_H
+
+#include <QImage>
+#include <QPolygon>
+
+namespace Flx
+{
+    /**
+     * Class extracts collision polygons from tile images
+     */
+    class TileOutline
+    {
+    public:
+        /**
+         * Function traces the outline of the opaque (alpha >= 128) pixels
+         * with marching squares over the pixel corners. Only the shape
+         * containing the first opaque pixel (in row order) is traced.
+         *
+         * @return polygon in pixel coordinates, empty if nothing is opaque
+         */
+        static QPolygon trace(const QImage &image);
+
+        /**
+         * Function removes vertices closer than tolerance pixels to the
+         * outline of the remaining ones (Ramer-Douglas-Peucker)
+         */
+        static QPolygon simplify(const QPolygon &polygon, qreal tolerance = DEFAULT_TOLERANCE);
+
+        static const qreal DEFAULT_TOLERANCE;
+
+    protected:
+        static void simplifyRange(const QPolygon &polygon, int first, int last,
+                                  qreal tolerance, QVector<bool> &keep);
+    };
+}
+
+#endif // TILEOUTLINE_H
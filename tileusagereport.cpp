@@ -0,0 +1,405 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#include <cstring>
+
+#include <QFileInfo>
+#include <QDir>
+#include <QTextStream>
+#include <QSet>
+#include <QStringList>
+#include <QMutexLocker>
+#include <QtAlgorithms>
+#include <QDebug>
+
+#include "atomicfile.h"
+#include "tilecache.h"
+#include "tileusagereport.h"
+
+using namespace Flx;
+
+namespace
+{
+    // near-duplicates are only looked for among tiles of the same size
+    // and a similar average colour, which keeps the search close to
+    // linear; buckets have to be wider than 4 * NEAR_DUPLICATE_TOLERANCE
+    const int THUMBNAIL_SIZE = 8;
+    const int BUCKET_SHIFT = 5;
+}
+
+void TileUsageReport::addLevel(const QString &levelFileName,
+                               const CompactMap *map,
+                               const QHash<int, int> &gidCounts,
+                               const QList<QPair<QString, QString> > &imageFiles)
+{
+    Level level;
+    foreach (CompactTileset *tileset, map->tilesets)
+    {
+        TilesetInfo info;
+        info.name = tileset->name();
+        info.tileKeys.resize(tileset->tileCount());
+        for (int id = 0; id < tileset->tileCount(); ++id)
+            info.tileKeys[id] = tileset->tileImageKey(id);
+        level.tilesets.append(info);
+    }
+
+    for (QHash<int, int>::const_iterator it = gidCounts.constBegin(); it != gidCounts.constEnd(); ++it)
+    {
+        CompactTileset *tileset = map->tilesetForGid(it.key());
+        if (tileset == NULL) continue;
+
+        int id = it.key() - tileset->firstGid();
+        qint64 key = tileset->tileImageKey(id);
+        level.usage[key] += it.value();
+
+        // tiles are analysed while their map is around, once per image
+        {
+            QMutexLocker locker(&this->mutex);
+            if (this->candidates.contains(key)) continue;
+        }
+        if (TileCache::instance()->isTransparent(tileset, id)) continue;
+
+        Candidate candidate = analyse(tileset->tileImage(id));
+        QMutexLocker locker(&this->mutex);
+        this->candidates.insert(key, candidate);
+    }
+
+    for (int i = 0; i < imageFiles.count(); ++i)
+    {
+        QFileInfo fileInfo(imageFiles.at(i).second);
+        if (!fileInfo.exists()) continue;
+
+        int j = 0;
+        while (j < level.imageBytes.count() && level.imageBytes.at(j).first != imageFiles.at(i).first) ++j;
+        if (j == level.imageBytes.count())
+            level.imageBytes.append(qMakePair(imageFiles.at(i).first, qint64(0)));
+        level.imageBytes[j].second += fileInfo.size();
+    }
+
+    QMutexLocker locker(&this->mutex);
+    this->levels.insert(QFileInfo(levelFileName).absoluteFilePath(), level);
+}
+
+void TileUsageReport::removeLevel(const QString &levelFileName)
+{
+    QMutexLocker locker(&this->mutex);
+    this->levels.remove(QFileInfo(levelFileName).absoluteFilePath());
+}
+
+bool TileUsageReport::write(const QString &fileName) const
+{
+    QMutexLocker locker(&this->mutex);
+
+    // cells by tile over all levels, and the tilesets of all levels; a
+    // tileset used by several levels is listed once
+    QHash<qint64, int> usage;
+    QList<TilesetInfo> tilesets;
+    QSet<QString> seenTilesets;
+    for (QMap<QString, Level>::const_iterator level = this->levels.constBegin();
+         level != this->levels.constEnd(); ++level)
+    {
+        for (QHash<qint64, int>::const_iterator it = level.value().usage.constBegin();
+             it != level.value().usage.constEnd(); ++it)
+        {
+            usage[it.key()] += it.value();
+        }
+
+        foreach (const TilesetInfo &tileset, level.value().tilesets)
+        {
+            QString identity = QString("%1:%2:%3").arg(tileset.name).arg(tileset.tileKeys.count())
+                    .arg(tileset.tileKeys.isEmpty() ? 0 : tileset.tileKeys.first());
+            if (seenTilesets.contains(identity)) continue;
+
+            seenTilesets.insert(identity);
+            tilesets.append(tileset);
+        }
+    }
+
+    // tiles are named after the first tileset listing them
+    QHash<qint64, QString> tileNames;
+    foreach (const TilesetInfo &tileset, tilesets)
+    {
+        for (int id = 0; id < tileset.tileKeys.count(); ++id)
+        {
+            if (!tileNames.contains(tileset.tileKeys.at(id)))
+                tileNames.insert(tileset.tileKeys.at(id), QString("%1 %2").arg(tileset.name).arg(id));
+        }
+    }
+
+    QString report;
+    QTextStream stream(&report);
+
+    if (this->levels.count() == 1)
+        stream << "Tiles unused in this level\n";
+    else
+        stream << "Tiles unused in all " << this->levels.count() << " levels\n";
+
+    foreach (const TilesetInfo &tileset, tilesets)
+    {
+        QList<int> unused;
+        for (int id = 0; id < tileset.tileKeys.count(); ++id)
+        {
+            if (!usage.contains(tileset.tileKeys.at(id)))
+                unused.append(id);
+        }
+
+        if (unused.count() == tileset.tileKeys.count())
+            stream << "  " << tileset.name << ": not used at all ("
+                   << tileset.tileKeys.count() << " tiles)\n";
+        else if (!unused.isEmpty())
+            stream << "  " << tileset.name << ": " << unused.count() << " of "
+                   << tileset.tileKeys.count() << " unused: " << formatRanges(unused) << "\n";
+    }
+
+    stream << "\nNear-duplicate used tiles\n";
+    TilePairs duplicates = this->findNearDuplicates(usage);
+    for (int i = 0; i < duplicates.count(); ++i)
+    {
+        qint64 a = duplicates.at(i).first;
+        qint64 b = duplicates.at(i).second;
+        stream << "  " << tileNames.value(a) << " (" << usage.value(a) << " cells) ~ "
+               << tileNames.value(b) << " (" << usage.value(b) << " cells)\n";
+    }
+
+    // levels are named by their path relative to the report
+    QDir reportDir(QFileInfo(fileName).absolutePath());
+    QList<QPair<QString, qint64> > imageBytes;
+    qint64 totalBytes = 0;
+    for (QMap<QString, Level>::const_iterator level = this->levels.constBegin();
+         level != this->levels.constEnd(); ++level)
+    {
+        QFileInfo levelInfo(reportDir.relativeFilePath(level.key()));
+        QString levelName = QDir::cleanPath(levelInfo.path() + "/" + levelInfo.completeBaseName());
+
+        for (int i = 0; i < level.value().imageBytes.count(); ++i)
+        {
+            const QPair<QString, qint64> &layer = level.value().imageBytes.at(i);
+            imageBytes.append(qMakePair(this->levels.count() == 1 ? layer.first
+                                                                 : levelName + ": " + layer.first,
+                                        layer.second));
+            totalBytes += layer.second;
+        }
+    }
+
+    stream << "\nImage bytes by layer\n";
+    for (int i = 0; i < imageBytes.count(); ++i)
+    {
+        qint64 bytes = imageBytes.at(i).second;
+        stream << "  " << imageBytes.at(i).first << ": " << bytes << " bytes ("
+               << QString::number(totalBytes > 0 ? 100.0 * bytes / totalBytes : 0.0, 'f', 1)
+               << "%)\n";
+    }
+    stream << "  total: " << totalBytes << " bytes\n";
+
+    stream << "\nCells by tile\n";
+    foreach (const TilesetInfo &tileset, tilesets)
+    {
+        for (int id = 0; id < tileset.tileKeys.count(); ++id)
+        {
+            qint64 key = tileset.tileKeys.at(id);
+            int cells = usage.value(key);
+            if (cells == 0 || tileNames.value(key) != QString("%1 %2").arg(tileset.name).arg(id))
+                continue;
+
+            stream << "  " << tileNames.value(key) << ": " << cells << "\n";
+        }
+    }
+    stream.flush();
+
+    if (!AtomicFile::writeIfChanged(fileName, report.toUtf8()))
+    {
+        qWarning() << "Could not save tile usage report " << fileName << "\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Function compares the used tiles of all levels. Tiles were reduced to
+ * small thumbnails when their levels were added; they are bucketed by
+ * size and coarsely quantized average colour. Near-duplicates differ by
+ * at most 4 * NEAR_DUPLICATE_TOLERANCE in their channel averages, less
+ * than a bucket is wide, so they always fall into the same or
+ * neighbouring buckets.
+ */
+TileUsageReport::TilePairs TileUsageReport::findNearDuplicates(const QHash<qint64, int> &usage) const
+{
+    // QMap and sorted keys, so that the report lists pairs in the same
+    // order every time
+    QList<qint64> keys = usage.keys();
+    qSort(keys);
+
+    QMap<QString, Bucket> buckets;
+    foreach (qint64 key, keys)
+    {
+        QHash<qint64, Candidate>::const_iterator it = this->candidates.constFind(key);
+        if (it == this->candidates.constEnd()) continue;
+
+        const int pixels = THUMBNAIL_SIZE * THUMBNAIL_SIZE;
+        int levels[4];
+        for (int c = 0; c < 4; ++c)
+            levels[c] = (it.value().sums[c] / pixels) >> BUCKET_SHIFT;
+
+        Bucket &bucket = buckets[bucketName(it.value().size, levels)];
+        bucket.size = it.value().size;
+        memcpy(bucket.levels, levels, sizeof(levels));
+        bucket.tiles.append(key);
+    }
+
+    TilePairs result;
+    for (QMap<QString, Bucket>::const_iterator it = buckets.constBegin(); it != buckets.constEnd(); ++it)
+    {
+        const Bucket &bucket = it.value();
+        this->compareCandidates(bucket.tiles, bucket.tiles, true, result);
+
+        // every pair of neighbouring buckets once: only offsets whose
+        // first non-zero component is positive
+        for (int offset = 0; offset < 81; ++offset)
+        {
+            int neighbour[4];
+            int step = offset;
+            bool positive = false, decided = false;
+            for (int c = 0; c < 4; ++c, step /= 3)
+            {
+                int d = step % 3 - 1;
+                neighbour[c] = bucket.levels[c] + d;
+                if (!decided && d != 0)
+                {
+                    positive = d > 0;
+                    decided = true;
+                }
+            }
+            if (!positive) continue;
+
+            QMap<QString, Bucket>::const_iterator other
+                    = buckets.constFind(bucketName(bucket.size, neighbour));
+            if (other != buckets.constEnd())
+                this->compareCandidates(bucket.tiles, other.value().tiles, false, result);
+        }
+    }
+    return result;
+}
+
+/**
+ * Function appends the near-duplicate pairs of two buckets (of the
+ * pairs within a bucket, if sameBucket)
+ */
+void TileUsageReport::compareCandidates(const QList<qint64> &a,
+                                        const QList<qint64> &b,
+                                        bool sameBucket,
+                                        TilePairs &result) const
+{
+    const int pixels = THUMBNAIL_SIZE * THUMBNAIL_SIZE;
+    const int maxDiff = NEAR_DUPLICATE_TOLERANCE * pixels * 4;
+    for (int i = 0; i < a.count(); ++i)
+    {
+        const Candidate &first = this->candidates[a.at(i)];
+        for (int j = sameBucket ? i + 1 : 0; j < b.count(); ++j)
+        {
+            const Candidate &second = this->candidates[b.at(j)];
+
+            // the difference of the channel sums is a cheap lower bound
+            // of the thumbnail difference
+            int sumDiff = 0;
+            for (int c = 0; c < 4; ++c)
+                sumDiff += qAbs(first.sums[c] - second.sums[c]);
+            if (sumDiff > maxDiff) continue;
+
+            if (difference(first.thumbnail, second.thumbnail) <= maxDiff)
+                result.append(qMakePair(a.at(i), b.at(j)));
+        }
+    }
+}
+
+/**
+ * Function reduces a tile image to a thumbnail and sums its channels
+ */
+TileUsageReport::Candidate TileUsageReport::analyse(const QImage &tileImage)
+{
+    Candidate candidate;
+    candidate.size = tileImage.size();
+    candidate.thumbnail = tileImage.convertToFormat(QImage::Format_ARGB32_Premultiplied)
+            .scaled(THUMBNAIL_SIZE, THUMBNAIL_SIZE, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+
+    int *sums = candidate.sums;
+    sums[0] = sums[1] = sums[2] = sums[3] = 0;
+    for (int y = 0; y < candidate.thumbnail.height(); ++y)
+    {
+        const QRgb *row = reinterpret_cast<const QRgb *>(candidate.thumbnail.constScanLine(y));
+        for (int x = 0; x < candidate.thumbnail.width(); ++x)
+        {
+            sums[0] += qAlpha(row[x]);
+            sums[1] += qRed(row[x]);
+            sums[2] += qGreen(row[x]);
+            sums[3] += qBlue(row[x]);
+        }
+    }
+    return candidate;
+}
+
+QString TileUsageReport::bucketName(const QSize &size, const int levels[4])
+{
+    return QString("%1x%2:%3,%4,%5,%6")
+            .arg(size.width()).arg(size.height())
+            .arg(levels[0]).arg(levels[1]).arg(levels[2]).arg(levels[3]);
+}
+
+/**
+ * @return sum of the channel differences of two thumbnails
+ */
+int TileUsageReport::difference(const QImage &a, const QImage &b)
+{
+    int sum = 0;
+    for (int y = 0; y < THUMBNAIL_SIZE; ++y)
+    {
+        const QRgb *rowA = reinterpret_cast<const QRgb *>(a.constScanLine(y));
+        const QRgb *rowB = reinterpret_cast<const QRgb *>(b.constScanLine(y));
+        for (int x = 0; x < THUMBNAIL_SIZE; ++x)
+        {
+            sum += qAbs(qAlpha(rowA[x]) - qAlpha(rowB[x]))
+                 + qAbs(qRed(rowA[x]) - qRed(rowB[x]))
+                 + qAbs(qGreen(rowA[x]) - qGreen(rowB[x]))
+                 + qAbs(qBlue(rowA[x]) - qBlue(rowB[x]));
+        }
+    }
+    return sum;
+}
+
+/**
+ * @return sorted ids as a compact list of ranges, e.g. "1, 4-7, 9"
+ */
+QString TileUsageReport::formatRanges(const QList<int> &ids)
+{
+    QStringList ranges;
+    for (int i = 0; i < ids.count(); )
+    {
+        int j = i;
+        while (j + 1 < ids.count() && ids.at(j + 1) == ids.at(j) + 1) ++j;
+
+        if (j == i)
+            ranges.append(QString::number(ids.at(i)));
+        else
+            ranges.append(QString("%1-%2").arg(ids.at(i)).arg(ids.at(j)));
+        i = j + 1;
+    }
+    return ranges.join(", ");
+}
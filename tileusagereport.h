@@ -0,0 +1,126 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef TILEUSAGEREPORT_H
+#define TILEUSAGEREPORT_H
+
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QMap>
+#include <QPair>
+#include <QVector>
+#include <QImage>
+#include <QMutex>
+
+#include "compactmap.h"
+
+namespace Flx
+{
+    /**
+     * Class collects how often the tiles of one or more levels are used
+     * and writes a plain text report listing unused tiles, near-duplicate
+     * tiles and each layer's share of the exported image bytes, to help
+     * pruning tilesets.
+     *
+     * Tiles are told apart by their image key (see
+     * CompactTileset::tileImageKey), so a tileset used by several maps is
+     * counted once, with the cells of all of them: a tile is only reported
+     * unused if no level added to the report uses it. Levels may be added
+     * from several threads at once (see the pack and watch modes).
+     *
+     * Near-duplicates are only looked for among used tiles (unused ones
+     * are listed anyway), so only their images need to be decoded.
+     */
+    class TileUsageReport
+    {
+    public:
+        /**
+         * Function adds a level, replacing what was added for the same
+         * level file before
+         *
+         * @param gidCounts cells using each GID, over all exported layers
+         * @param imageFiles exported images (layer name, file) counted
+         *        towards each layer
+         */
+        void addLevel(const QString &levelFileName,
+                      const CompactMap *map,
+                      const QHash<int, int> &gidCounts,
+                      const QList<QPair<QString, QString> > &imageFiles);
+
+        void removeLevel(const QString &levelFileName);
+
+        bool write(const QString &fileName) const;
+
+        /**
+         * Mean difference per channel (0-255) up to which two tiles count
+         * as near-duplicates
+         */
+        static const int NEAR_DUPLICATE_TOLERANCE = 6;
+
+    protected:
+        struct TilesetInfo
+        {
+            QString name;
+            QVector<qint64> tileKeys;       // by tile id
+        };
+
+        struct Level
+        {
+            QHash<qint64, int> usage;                       // cells by tile key
+            QList<TilesetInfo> tilesets;
+            QList<QPair<QString, qint64> > imageBytes;      // by layer, export order
+        };
+
+        struct Candidate
+        {
+            QSize size;
+            QImage thumbnail;
+            int sums[4];        // of the thumbnail's alpha, red, green, blue
+        };
+
+        struct Bucket
+        {
+            QSize size;
+            int levels[4];      // quantized average alpha, red, green, blue
+            QList<qint64> tiles;
+        };
+
+        typedef QList<QPair<qint64, qint64> > TilePairs;
+
+        TilePairs findNearDuplicates(const QHash<qint64, int> &usage) const;
+        void compareCandidates(const QList<qint64> &a,
+                               const QList<qint64> &b,
+                               bool sameBucket,
+                               TilePairs &result) const;
+        static Candidate analyse(const QImage &tileImage);
+        static QString bucketName(const QSize &size, const int levels[4]);
+        static int difference(const QImage &a, const QImage &b);
+        static QString formatRanges(const QList<int> &ids);
+
+        QMap<QString, Level> levels;                // by absolute level file name
+        QHash<qint64, Candidate> candidates;        // thumbnails of used tiles, by tile key
+        mutable QMutex mutex;
+    };
+}
+
+#endif // TILEUSAGEREPORT_H
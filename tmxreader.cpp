@@ -0,0 +1,774 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#include <cstring>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include <QImageReader>
+#include <QDebug>
+#include <QRect>
+
+#include <zlib.h>
+
+#include "pngreader.h"
+#include "tmxreader.h"
+
+using namespace Flx;
+
+namespace
+{
+    /**
+     * Decodes the content of a layer's <data> element into its GID grid
+     * as the text arrives, whatever the encoding
+     */
+    class LayerDataDecoder
+    {
+    public:
+        LayerDataDecoder(TileGrid *grid, const QString &encoding, const QString &compression);
+        ~LayerDataDecoder();
+
+        bool isValid() const { return mError.isEmpty(); }
+        const QString &errorString() const { return mError; }
+
+        void addText(const QStringRef &text);
+        void addGid(uint gid);
+
+        bool finish();
+
+    protected:
+        void addCsv(const QStringRef &text);
+        void addBase64(const QStringRef &text);
+        void addBinary(const char *data, int size);
+        void addBytes(const char *data, int size);
+
+        enum { INFLATE_BUFFER_SIZE = 16 * 1024 };
+
+        TileGrid *grid;
+        int cell;
+        int cellCount;
+
+        bool csv;
+        bool base64;
+        bool compressed;
+        QString mError;
+
+        uint csvValue;
+        bool csvInNumber;
+
+        QByteArray base64Carry;
+        char byteCarry[4];
+        int byteCarryCount;
+
+        z_stream stream;
+        bool streamEnded;
+    };
+
+    LayerDataDecoder::LayerDataDecoder(TileGrid *grid,
+                                       const QString &encoding,
+                                       const QString &compression)
+        : grid(grid),
+          cell(0),
+          cellCount(grid->width() * grid->height()),
+          csv(encoding == "csv"),
+          base64(encoding == "base64"),
+          compressed(false),
+          csvValue(0),
+          csvInNumber(false),
+          byteCarryCount(0),
+          streamEnded(false)
+    {
+        if (!encoding.isEmpty() && !csv && !base64)
+            mError = QString("Unknown layer encoding '%1'").arg(encoding);
+
+        if (compression == "zlib" || compression == "gzip")
+        {
+            stream.zalloc = Z_NULL;
+            stream.zfree = Z_NULL;
+            stream.opaque = Z_NULL;
+            stream.next_in = Z_NULL;
+            stream.avail_in = 0;
+
+            // 15 + 32 detects zlib and gzip headers automatically
+            if (inflateInit2(&stream, 15 + 32) == Z_OK)
+                compressed = true;
+            else
+                mError = "Could not initialise zlib";
+        }
+        else if (!compression.isEmpty())
+        {
+            mError = QString("Unknown layer compression '%1'").arg(compression);
+        }
+    }
+
+    LayerDataDecoder::~LayerDataDecoder()
+    {
+        if (compressed)
+            inflateEnd(&stream);
+    }
+
+    void LayerDataDecoder::addGid(uint gid)
+    {
+        if (cell >= cellCount)
+        {
+            ++cell;
+            return;
+        }
+
+        // the upper bits are flip flags, not part of the tile ID
+        grid->set(cell % grid->width(), cell / grid->width(), int(gid & 0x1FFFFFFF));
+        ++cell;
+    }
+
+    void LayerDataDecoder::addText(const QStringRef &text)
+    {
+        if (!this->isValid()) return;
+
+        if (csv)
+            this->addCsv(text);
+        else if (base64)
+            this->addBase64(text);
+    }
+
+    void LayerDataDecoder::addCsv(const QStringRef &text)
+    {
+        const QChar *c = text.unicode();
+        for (int i = 0; i < text.size(); ++i)
+        {
+            ushort u = c[i].unicode();
+            if (u >= '0' && u <= '9')
+            {
+                csvValue = csvValue * 10 + (u - '0');
+                csvInNumber = true;
+            }
+            else if (u == ',' || c[i].isSpace())
+            {
+                if (csvInNumber)
+                    this->addGid(csvValue);
+                csvValue = 0;
+                csvInNumber = false;
+            }
+            else
+            {
+                mError = QString("Invalid character '%1' in CSV layer data").arg(c[i]);
+                return;
+            }
+        }
+    }
+
+    void LayerDataDecoder::addBase64(const QStringRef &text)
+    {
+        const QChar *c = text.unicode();
+        for (int i = 0; i < text.size(); ++i)
+        {
+            if (!c[i].isSpace())
+                base64Carry.append(c[i].toLatin1());
+        }
+
+        // only whole 4 character groups can be decoded on their own
+        int usable = base64Carry.size() & ~3;
+        if (usable == 0) return;
+
+        QByteArray bytes = QByteArray::fromBase64(base64Carry.left(usable));
+        base64Carry.remove(0, usable);
+        this->addBinary(bytes.constData(), bytes.size());
+    }
+
+    void LayerDataDecoder::addBinary(const char *data, int size)
+    {
+        if (!compressed)
+        {
+            this->addBytes(data, size);
+            return;
+        }
+
+        if (streamEnded) return;
+
+        char buffer[INFLATE_BUFFER_SIZE];
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+        stream.avail_in = size;
+
+        do
+        {
+            stream.next_out = reinterpret_cast<Bytef *>(buffer);
+            stream.avail_out = INFLATE_BUFFER_SIZE;
+
+            int ret = inflate(&stream, Z_NO_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+            {
+                mError = QString("Corrupt compressed layer data (zlib error %1)").arg(ret);
+                return;
+            }
+
+            this->addBytes(buffer, INFLATE_BUFFER_SIZE - stream.avail_out);
+
+            if (ret == Z_STREAM_END)
+            {
+                streamEnded = true;
+                return;
+            }
+        }
+        while (stream.avail_out == 0);
+    }
+
+    void LayerDataDecoder::addBytes(const char *data, int size)
+    {
+        const uchar *bytes = reinterpret_cast<const uchar *>(data);
+        int i = 0;
+
+        // finish a GID split between two chunks
+        while (byteCarryCount > 0 && byteCarryCount < 4 && i < size)
+            byteCarry[byteCarryCount++] = bytes[i++];
+        if (byteCarryCount == 4)
+        {
+            const uchar *b = reinterpret_cast<const uchar *>(byteCarry);
+            this->addGid(b[0] | b[1] << 8 | b[2] << 16 | uint(b[3]) << 24);
+            byteCarryCount = 0;
+        }
+
+        for (; i + 4 <= size; i += 4)
+            this->addGid(bytes[i] | bytes[i + 1] << 8 | bytes[i + 2] << 16 | uint(bytes[i + 3]) << 24);
+
+        while (i < size)
+            byteCarry[byteCarryCount++] = bytes[i++];
+    }
+
+    /**
+     * Function reads the <property> elements of a <properties> element
+     */
+    void readProperties(QXmlStreamReader &xml, QMap<QString, QString> &properties)
+    {
+        while (xml.readNextStartElement())
+        {
+            if (xml.name() == "property")
+            {
+                QString name = xml.attributes().value("name").toString();
+                if (xml.attributes().hasAttribute("value"))
+                {
+                    properties.insert(name, xml.attributes().value("value").toString());
+                    xml.skipCurrentElement();
+                }
+                else
+                {
+                    properties.insert(name, xml.readElementText());
+                }
+            }
+            else
+            {
+                xml.skipCurrentElement();
+            }
+        }
+    }
+
+    bool LayerDataDecoder::finish()
+    {
+        if (!this->isValid()) return false;
+
+        if (csv && csvInNumber)
+            this->addGid(csvValue);
+
+        if (base64 && !base64Carry.isEmpty())
+            mError = "Truncated base64 layer data";
+        else if (compressed && !streamEnded)
+            mError = "Truncated compressed layer data";
+        else if (byteCarryCount != 0 || cell != cellCount)
+            mError = QString("Layer data has %1 tiles, expected %2").arg(cell).arg(cellCount);
+
+        return this->isValid();
+    }
+}
+
+TmxTileset::TmxTileset(int firstGid, const QString &sourceFileName)
+    : CompactTileset(firstGid),
+      sourceFileName(sourceFileName),
+      spacing(0),
+      margin(0),
+      usedTilesDecoded(false),
+      imageLoaded(false),
+      columns(0),
+      imageKey(0)
+{
+}
+
+void TmxTileset::readTileset(QXmlStreamReader &xml, const QDir &baseDir)
+{
+    QXmlStreamAttributes attributes = xml.attributes();
+    mName = attributes.value("name").toString();
+    mTileWidth = attributes.value("tilewidth").toString().toInt();
+    mTileHeight = attributes.value("tileheight").toString().toInt();
+    this->spacing = attributes.value("spacing").toString().toInt();
+    this->margin = attributes.value("margin").toString().toInt();
+
+    while (xml.readNextStartElement())
+    {
+        if (xml.name() == "image")
+        {
+            this->imageFileName = baseDir.absoluteFilePath(xml.attributes().value("source").toString());
+
+            QString trans = xml.attributes().value("trans").toString();
+            if (!trans.isEmpty())
+                this->transparentColor = QColor(trans.startsWith('#') ? trans : "#" + trans);
+        }
+        else if (xml.name() == "tile")
+        {
+            int id = xml.attributes().value("id").toString().toInt();
+            while (xml.readNextStartElement())
+            {
+                if (xml.name() == "properties")
+                    readProperties(xml, this->properties[id]);
+                else
+                    xml.skipCurrentElement();
+            }
+            continue;
+        }
+        xml.skipCurrentElement();
+    }
+}
+
+QMap<QString, QString> TmxTileset::tileProperties(int id)
+{
+    this->resolve();
+    return this->properties.value(id);
+}
+
+void TmxTileset::load()
+{
+    if (!this->sourceFileName.isEmpty())
+    {
+        QFile file(this->sourceFileName);
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            qWarning() << "Could not open tileset " << this->sourceFileName << "\n";
+            return;
+        }
+
+        QXmlStreamReader xml(&file);
+        if (xml.readNextStartElement() && xml.name() == "tileset")
+            this->readTileset(xml, QFileInfo(this->sourceFileName).absoluteDir());
+
+        if (xml.hasError())
+            qWarning() << "Could not read tileset " << this->sourceFileName
+                       << ": " << xml.errorString() << "\n";
+    }
+
+    // the tile count only needs the image header, not its pixels
+    QSize imageSize = QImageReader(this->imageFileName).size();
+    if (mTileWidth > 0 && mTileHeight > 0 && imageSize.isValid())
+    {
+        this->columns = (imageSize.width() - 2 * this->margin + this->spacing)
+                / (mTileWidth + this->spacing);
+        int rows = (imageSize.height() - 2 * this->margin + this->spacing)
+                / (mTileHeight + this->spacing);
+        mTileCount = this->columns * rows;
+    }
+
+    // the key covers everything the tile images depend on: the image
+    // file, including its contents (modification times are too coarse to
+    // tell quick re-saves apart), and how the tileset cuts and keys it
+    QFileInfo imageInfo(this->imageFileName);
+    QByteArray signatureData;
+    QDataStream signature(&signatureData, QIODevice::WriteOnly);
+    signature << imageInfo.absoluteFilePath() << imageInfo.lastModified().toMSecsSinceEpoch()
+              << imageInfo.size()
+              << mTileWidth << mTileHeight << this->spacing << this->margin
+              << this->transparentColor.isValid() << this->transparentColor.rgb();
+
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(signatureData);
+
+    QFile imageFile(this->imageFileName);
+    if (imageFile.open(QIODevice::ReadOnly))
+    {
+        while (!imageFile.atEnd())
+            hash.addData(imageFile.read(64 * 1024));
+    }
+
+    QByteArray digest = hash.result();
+    memcpy(&this->imageKey, digest.constData(), sizeof(this->imageKey));
+}
+
+QImage TmxTileset::tileImage(int id)
+{
+    this->resolve();
+
+    if (this->columns <= 0 || id < 0 || id >= mTileCount)
+        return QImage();
+
+    if (!this->usedTilesDecoded && this->usedTiles.contains(id))
+        this->decodeUsedTiles();
+
+    QHash<int, QImage>::const_iterator it = this->tiles.constFind(id);
+    if (it != this->tiles.constEnd())
+        return it.value();
+
+    if (!this->imageLoaded)
+    {
+        this->imageLoaded = true;
+        if (!this->image.load(this->imageFileName))
+            qWarning() << "Could not load tileset image " << this->imageFileName << "\n";
+
+        if (!this->image.isNull())
+            this->applyTransparentColor(this->image);
+    }
+
+    return this->image.copy(this->tileRect(id));
+}
+
+void TmxTileset::setUsedTiles(const QSet<int> &ids)
+{
+    this->usedTiles = ids;
+}
+
+QRect TmxTileset::tileRect(int id) const
+{
+    return QRect(this->margin + (id % this->columns) * (mTileWidth + this->spacing),
+                 this->margin + (id / this->columns) * (mTileHeight + this->spacing),
+                 mTileWidth, mTileHeight);
+}
+
+/**
+ * Function decodes the tiles the map uses, and nothing below the last of
+ * them. Images other than (non-interlaced) PNGs are decoded clipped to
+ * the used tiles, which saves work for formats that support it.
+ * On failure, no tile is cached and the whole image is decoded instead.
+ */
+void TmxTileset::decodeUsedTiles()
+{
+    this->usedTilesDecoded = true;
+
+    QList<int> ids;
+    foreach (int id, this->usedTiles)
+    {
+        if (id >= 0 && id < mTileCount)
+            ids.append(id);
+    }
+    if (ids.isEmpty()) return;
+
+    QHash<int, QImage> decoded;
+    if (!this->decodeUsedTilesFromPng(ids, decoded)
+        && !this->decodeUsedTilesFromClip(ids, decoded))
+    {
+        return;
+    }
+
+    for (QHash<int, QImage>::iterator it = decoded.begin(); it != decoded.end(); ++it)
+        this->applyTransparentColor(it.value());
+    this->tiles = decoded;
+}
+
+bool TmxTileset::decodeUsedTilesFromPng(const QList<int> &ids, QHash<int, QImage> &decoded)
+{
+    QFile file(this->imageFileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    PngReader reader(&file);
+    if (!reader.readHeader())
+        return false;
+
+    // used tiles by tile row
+    QHash<int, QList<int> > tileRows;
+    int lastRow = 0;
+    foreach (int id, ids)
+    {
+        QRect rect = this->tileRect(id);
+        if (rect.right() >= reader.width() || rect.bottom() >= reader.height())
+            return false;
+
+        tileRows[id / this->columns].append(id);
+        lastRow = qMax(lastRow, rect.bottom());
+
+        QImage tile(mTileWidth, mTileHeight, QImage::Format_ARGB32);
+        decoded.insert(id, tile);
+    }
+
+    QVector<QRgb> row(reader.width());
+    for (int y = 0; y <= lastRow; ++y)
+    {
+        if (!reader.readRow(row.data()))
+        {
+            qWarning() << "Could not decode tileset image " << this->imageFileName << "\n";
+            decoded.clear();
+            return false;
+        }
+
+        int offset = y - this->margin;
+        if (offset < 0 || offset % (mTileHeight + this->spacing) >= mTileHeight)
+            continue;
+
+        QHash<int, QList<int> >::const_iterator it = tileRows.constFind(offset / (mTileHeight + this->spacing));
+        if (it == tileRows.constEnd())
+            continue;
+
+        int tileY = offset % (mTileHeight + this->spacing);
+        foreach (int id, it.value())
+        {
+            memcpy(decoded[id].scanLine(tileY), row.constData() + this->tileRect(id).x(),
+                   mTileWidth * sizeof(QRgb));
+        }
+    }
+    return true;
+}
+
+bool TmxTileset::decodeUsedTilesFromClip(const QList<int> &ids, QHash<int, QImage> &decoded)
+{
+    QRect clip;
+    foreach (int id, ids)
+        clip |= this->tileRect(id);
+
+    QImageReader reader(this->imageFileName);
+    reader.setClipRect(clip);
+    QImage region = reader.read();
+    if (region.isNull())
+        return false;
+
+    foreach (int id, ids)
+        decoded.insert(id, region.copy(this->tileRect(id).translated(-clip.topLeft())));
+    return true;
+}
+
+/**
+ * Function clears the pixels of the tileset's transparent colour, if any
+ */
+void TmxTileset::applyTransparentColor(QImage &image) const
+{
+    if (!this->transparentColor.isValid())
+        return;
+
+    image = image.convertToFormat(QImage::Format_ARGB32);
+    QRgb trans = this->transparentColor.rgb() & RGB_MASK;
+    for (int y = 0; y < image.height(); ++y)
+    {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x)
+            if ((line[x] & RGB_MASK) == trans) line[x] = 0;
+    }
+}
+
+qint64 TmxTileset::tileImageKey(int id)
+{
+    this->resolve();
+
+    // stable across tileset objects (and runs) while the image is unchanged;
+    // the odd stride keeps the keys of one image distinct, and those of
+    // different images only collide as likely as their 64 bit digests
+    return qint64(this->imageKey + quint64(id) * Q_UINT64_C(0x9E3779B97F4A7C15));
+}
+
+QStringList TmxTileset::sourceFiles()
+{
+    this->resolve();
+
+    QStringList files;
+    if (!this->sourceFileName.isEmpty())
+        files.append(this->sourceFileName);
+    if (!this->imageFileName.isEmpty())
+        files.append(this->imageFileName);
+    return files;
+}
+
+QStringList TmxReader::dependencies(const CompactMap *map)
+{
+    QStringList files;
+    foreach (CompactTileset *tileset, map->tilesets)
+        files += static_cast<TmxTileset *>(tileset)->sourceFiles();
+    return files;
+}
+
+CompactMap *TmxReader::read(const QString &fileName)
+{
+    mError.clear();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        mError = QString("Could not open %1").arg(fileName);
+        return NULL;
+    }
+
+    this->mapDir = QFileInfo(fileName).absoluteDir();
+    this->xml.setDevice(&file);
+
+    CompactMap *map = new CompactMap();
+    if (this->xml.readNextStartElement() && this->xml.name() == "map")
+        this->readMap(map);
+    else
+        this->xml.raiseError("Not a TMX map file");
+
+    this->xml.setDevice(NULL);
+
+    if (this->xml.hasError())
+    {
+        mError = QString("%1:%2: %3").arg(fileName)
+                .arg(this->xml.lineNumber())
+                .arg(this->xml.errorString());
+        delete map;
+        return NULL;
+    }
+
+    this->reportUsedTiles(map);
+    return map;
+}
+
+void TmxReader::readMap(CompactMap *map)
+{
+    QXmlStreamAttributes attributes = this->xml.attributes();
+    map->width = attributes.value("width").toString().toInt();
+    map->height = attributes.value("height").toString().toInt();
+    map->tileWidth = attributes.value("tilewidth").toString().toInt();
+    map->tileHeight = attributes.value("tileheight").toString().toInt();
+
+    while (this->xml.readNextStartElement())
+    {
+        if (this->xml.name() == "tileset")
+        {
+            int firstGid = this->xml.attributes().value("firstgid").toString().toInt();
+            QString source = this->xml.attributes().value("source").toString();
+
+            TmxTileset *tileset;
+            if (source.isEmpty())
+            {
+                tileset = new TmxTileset(firstGid);
+                tileset->readTileset(this->xml, this->mapDir);
+            }
+            else
+            {
+                tileset = new TmxTileset(firstGid, this->mapDir.absoluteFilePath(source));
+                this->xml.skipCurrentElement();
+            }
+            map->tilesets.append(tileset);
+        }
+        else if (this->xml.name() == "layer")
+        {
+            this->readLayer(map);
+        }
+        else if (this->xml.name() == "properties")
+        {
+            this->readProperties(map->properties);
+        }
+        else
+        {
+            // object groups are not supported yet
+            this->xml.skipCurrentElement();
+        }
+    }
+}
+
+void TmxReader::readLayer(CompactMap *map)
+{
+    QXmlStreamAttributes attributes = this->xml.attributes();
+
+    CompactLayer *layer = new CompactLayer();
+    map->addLayer(layer);
+
+    layer->name = attributes.value("name").toString();
+    layer->visible = attributes.value("visible") != "0";
+    if (attributes.hasAttribute("opacity"))
+        layer->opacity = attributes.value("opacity").toString().toDouble();
+
+    int width = attributes.value("width").toString().toInt();
+    int height = attributes.value("height").toString().toInt();
+    layer->gids = TileGrid(width, height);
+
+    while (this->xml.readNextStartElement())
+    {
+        if (this->xml.name() == "data")
+            this->readLayerData(layer);
+        else if (this->xml.name() == "properties")
+            this->readProperties(layer->properties);
+        else
+            this->xml.skipCurrentElement();
+    }
+}
+
+void TmxReader::readLayerData(CompactLayer *layer)
+{
+    LayerDataDecoder decoder(&layer->gids,
+                             this->xml.attributes().value("encoding").toString(),
+                             this->xml.attributes().value("compression").toString());
+
+    while (!this->xml.atEnd() && decoder.isValid())
+    {
+        QXmlStreamReader::TokenType token = this->xml.readNext();
+        if (token == QXmlStreamReader::EndElement)
+            break;
+
+        if (token == QXmlStreamReader::Characters)
+        {
+            decoder.addText(this->xml.text());
+        }
+        else if (token == QXmlStreamReader::StartElement)
+        {
+            if (this->xml.name() == "tile")
+                decoder.addGid(this->xml.attributes().value("gid").toString().toUInt());
+            this->xml.skipCurrentElement();
+        }
+    }
+
+    if (!decoder.finish())
+        this->xml.raiseError(QString("Layer '%1': %2").arg(layer->name, decoder.errorString()));
+}
+
+/**
+ * Function tells every tileset which of its tiles the visible layers use,
+ * so that only those are decoded from its image
+ */
+void TmxReader::reportUsedTiles(CompactMap *map)
+{
+    QSet<int> gids;
+    foreach (const CompactLayer *layer, map->layers)
+    {
+        if (!layer->visible) continue;
+
+        for (int j = 0; j < layer->gids.height(); ++j)
+        {
+            const int *row = layer->gids.constRow(j);
+            int previous = 0;
+            for (int i = 0; i < layer->gids.width(); ++i)
+            {
+                // runs of the same tile are common
+                if (row[i] != 0 && row[i] != previous)
+                    gids.insert(row[i]);
+                previous = row[i];
+            }
+        }
+    }
+
+    QHash<CompactTileset *, QSet<int> > usedTiles;
+    foreach (int gid, gids)
+    {
+        CompactTileset *tileset = map->tilesetForGid(gid);
+        if (tileset)
+            usedTiles[tileset].insert(gid - tileset->firstGid());
+    }
+
+    foreach (CompactTileset *tileset, map->tilesets)
+        static_cast<TmxTileset *>(tileset)->setUsedTiles(usedTiles.value(tileset));
+}
+
+void TmxReader::readProperties(QMap<QString, QString> &properties)
+{
+    ::readProperties(this->xml, properties);
+}
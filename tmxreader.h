@@ -0,0 +1,139 @@
+/*
+ * FlxExporter for Tiled Map Editor (Qt)
+ * Copyright 2010 Jnis Kirteins <janis@janiskirsteins.org>
+ *
+ * This file is part of FlxExporter for Tiled Map Editor
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef TMXREADER_H
+#define TMXREADER_H
+
+#include <QString>
+#include <QStringList>
+#include <QDir>
+#include <QHash>
+#include <QSet>
+#include <QMap>
+#include <QImage>
+#include <QColor>
+#include <QXmlStreamReader>
+
+#include "compactmap.h"
+
+namespace Flx
+{
+    /**
+     * Tileset of a TMX file (embedded or external .tsx).
+     *
+     * External tilesets are only parsed, and tileset images only decoded,
+     * once something asks for them. Of the image, only the tiles the map
+     * uses are decoded (and cached), in a single pass that stops after the
+     * last of them; the whole image is only decoded if another tile is
+     * asked for.
+     */
+    class TmxTileset : public CompactTileset
+    {
+    public:
+        TmxTileset(int firstGid, const QString &sourceFileName = QString());
+
+        /**
+         * Function reads the attributes and image of a <tileset> element
+         * the reader is positioned at
+         */
+        void readTileset(QXmlStreamReader &xml, const QDir &baseDir);
+
+        QImage tileImage(int id);
+        qint64 tileImageKey(int id);
+        QMap<QString, QString> tileProperties(int id);
+
+        /**
+         * Function sets the (local) ids of the tiles the map uses
+         */
+        void setUsedTiles(const QSet<int> &ids);
+
+        /**
+         * @return the .tsx file (for external tilesets) and the image file
+         *         the tileset is read from
+         */
+        QStringList sourceFiles();
+
+    protected:
+        void load();
+
+        QRect tileRect(int id) const;
+        void decodeUsedTiles();
+        bool decodeUsedTilesFromPng(const QList<int> &ids, QHash<int, QImage> &decoded);
+        bool decodeUsedTilesFromClip(const QList<int> &ids, QHash<int, QImage> &decoded);
+        void applyTransparentColor(QImage &image) const;
+
+        QString sourceFileName;
+
+        int spacing;
+        int margin;
+        QString imageFileName;
+        QColor transparentColor;
+        QHash<int, QMap<QString, QString> > properties;     // by tile id
+
+        QSet<int> usedTiles;
+        bool usedTilesDecoded;
+        QHash<int, QImage> tiles;      // decoded used tiles, by tile id
+
+        bool imageLoaded;
+        QImage image;
+        int columns;
+        quint64 imageKey;      // digest of the image and tile geometry
+    };
+
+    /**
+     * Class reads TMX files straight into a CompactMap.
+     *
+     * Layer data is decoded while it is read (CSV, base64 and
+     * zlib/gzip-compressed base64, as well as per-tile XML), so no
+     * intermediate copy of a layer is ever held. Object groups are skipped.
+     */
+    class TmxReader
+    {
+    public:
+        /**
+         * @return the map (owned by the caller), or NULL on error
+         * @see errorString
+         */
+        CompactMap *read(const QString &fileName);
+
+        const QString &errorString() const { return mError; }
+
+        /**
+         * @return every file (other than the TMX file) a map read by
+         *         TmxReader depends on
+         */
+        static QStringList dependencies(const CompactMap *map);
+
+    protected:
+        void readMap(CompactMap *map);
+        void readLayer(CompactMap *map);
+        void readLayerData(CompactLayer *layer);
+        void readProperties(QMap<QString, QString> &properties);
+        void reportUsedTiles(CompactMap *map);
+
+        QXmlStreamReader xml;
+        QDir mapDir;
+        QString mError;
+    };
+}
+
+#endif // TMXREADER_H